@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "pebble.h"
+#include "ephemeris.h"
+//
+// Host benchmark of full-day table generation
+//
+// Builds the 25 hourly sun and moon samples that the watchface computes on
+// every rebuild, over a grid of latitudes, longitudes and dates, with
+// whichever engine libephemeris was compiled for.  Reports the trig lookups
+// per table and, for the float engine, how far the stepped observer tables
+// are from calling sunPosition/moonPosition for every sample, and what each
+// planet added to the batched engine costs per table.
+//
+
+#define START_2026 1767225600  // 2026-01-01 00:00:00 UTC
+#define LAT_STEP 10
+#define LNG_STEP 45
+#define DAY_STEP 7
+#define PASSES 5
+
+static volatile float s_sink;
+
+#ifndef EPHEMERIS_FIXED_POINT
+static float azimuth_table(float azi) {
+  return fmod_pebble((azi + pi) * deg_conv, 360);
+}
+
+// one full sunPosition/moonPosition per sample, as tables were built before
+// the observer context
+static void sky_paths_per_sample(time_t day_start, float lat, float lng, float solar_elev[], float solar_azi[], float lunar_elev[], float lunar_azi[]) {
+  float azi, alt;
+  int i;
+  for (i = 0; i < 25; i++) {
+    sunPosition(day_start + i * 3600, lat, lng, &azi, &alt);
+    solar_elev[i] = alt * deg_conv;
+    solar_azi[i] = azimuth_table(azi);
+    moonPosition(day_start + i * 3600, lat, lng, &azi, &alt);
+    lunar_elev[i] = alt * deg_conv;
+    lunar_azi[i] = azimuth_table(azi);
+  }
+}
+
+// azimuth is only compared within 45 degrees of the horizon, near the zenith
+// it is ill-conditioned
+static float max_difference(const float a[], const float b[], const float elev[], float max) {
+  int i;
+  bool wrap = elev != NULL;
+  for (i = 0; i < 25; i++) {
+    if (wrap && (elev[i] > 45 || elev[i] < -45)) continue;
+    float d = a[i] - b[i];
+    if (wrap && d > 180) d -= 360;
+    if (wrap && d < -180) d += 360;
+    if (d < 0) d = -d;
+    if (d > max) max = d;
+  }
+  return max;
+}
+#endif
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+#ifndef EPHEMERIS_FIXED_POINT
+// best time of PASSES for a day table of the first count bodies, over the
+// same grid as above, and the trig lookups it takes
+static double time_bodies(int count, unsigned long *lookups) {
+  static const SkyBody bodies[] = { SKY_BODY_SUN, SKY_BODY_MOON, SKY_BODY_VENUS, SKY_BODY_MARS, SKY_BODY_JUPITER };
+  float tables[2][SKY_BODY_COUNT][25];
+  float *elev[SKY_BODY_COUNT], *azi[SKY_BODY_COUNT];
+  int pass, lat, lng, day, k, tables_built = 0;
+  double best = 0;
+
+  for (k = 0; k < SKY_BODY_COUNT; k++) {
+    elev[k] = tables[0][k];
+    azi[k] = tables[1][k];
+  }
+  for (pass = 0; pass < PASSES; pass++) {
+    double start = now_ns();
+    tables_built = 0;
+    for (lat = -90; lat <= 90; lat += LAT_STEP) {
+      for (lng = -180; lng < 180; lng += LNG_STEP) {
+        for (day = 0; day < 365; day += DAY_STEP) {
+          sky_bodies_hours(START_2026 + day * 86400, 0, 24, lat, lng, bodies, count, elev, azi);
+          s_sink = elev[count - 1][12];
+          tables_built++;
+        }
+      }
+    }
+    double elapsed = now_ns() - start;
+    if (pass == 0 || elapsed < best) best = elapsed;
+  }
+  *lookups = host_trig_lookups;
+  sky_bodies_hours(START_2026, 0, 24, 64.8, -147, bodies, count, elev, azi);
+  *lookups = host_trig_lookups - *lookups;
+  return best / tables_built;
+}
+#endif
+
+int main(int argc, char **argv) {
+  float solar_elev[25], solar_azi[25], lunar_elev[25], lunar_azi[25];
+  int pass, lat, lng, day, tables = 0;
+  double best = 0;
+
+  if (argc > 1 && strcmp(argv[1], "-v") == 0) host_app_log_enabled = true;
+
+  for (pass = 0; pass < PASSES; pass++) {
+    double start = now_ns();
+    tables = 0;
+    for (lat = -90; lat <= 90; lat += LAT_STEP) {
+      for (lng = -180; lng < 180; lng += LNG_STEP) {
+        for (day = 0; day < 365; day += DAY_STEP) {
+          sky_paths_hours(START_2026 + day * 86400, 0, 24, lat, lng, solar_elev, solar_azi, lunar_elev, lunar_azi);
+          s_sink = solar_elev[12] + lunar_azi[12];
+          tables++;
+        }
+      }
+    }
+    double elapsed = now_ns() - start;
+    if (pass == 0 || elapsed < best) best = elapsed;
+  }
+
+#ifdef EPHEMERIS_FIXED_POINT
+  const char *engine = "fixed";
+#else
+  const char *engine = "float";
+#endif
+  printf("%s engine: %d day tables in %.2f ms, %.2f us per table, %.1f ns per hourly sample (best of %d)\n",
+         engine, tables, best / 1e6, best / tables / 1e3, best / tables / 25, PASSES);
+
+  unsigned long lookups = host_trig_lookups;
+  sky_paths_hours(START_2026, 0, 24, 64.8, -147, solar_elev, solar_azi, lunar_elev, lunar_azi);
+  printf("%s engine: %lu trig lookups per day table\n", engine, host_trig_lookups - lookups);
+
+#ifndef EPHEMERIS_FIXED_POINT
+  float ref[4][25];
+  float max_elev = 0, max_azi = 0;
+  lookups = host_trig_lookups;
+  sky_paths_per_sample(START_2026, 64.8, -147, ref[0], ref[1], ref[2], ref[3]);
+  printf("per-sample sunPosition/moonPosition: %lu trig lookups per day table\n", host_trig_lookups - lookups);
+  for (lat = -85; lat <= 85; lat += 5) {
+    for (day = 0; day < 365; day++) {
+      sky_paths_hours(START_2026 + day * 86400, 0, 24, lat, -147, solar_elev, solar_azi, lunar_elev, lunar_azi);
+      sky_paths_per_sample(START_2026 + day * 86400, lat, -147, ref[0], ref[1], ref[2], ref[3]);
+      max_elev = max_difference(solar_elev, ref[0], NULL, max_elev);
+      max_elev = max_difference(lunar_elev, ref[2], NULL, max_elev);
+      max_azi = max_difference(solar_azi, ref[1], ref[0], max_azi);
+      max_azi = max_difference(lunar_azi, ref[3], ref[2], max_azi);
+    }
+  }
+  printf("observer vs per-sample tables, latitudes -85..85 over 2026: max elevation difference %.3f deg, max azimuth difference %.3f deg\n",
+         max_elev, max_azi);
+
+  // the batched engine with the sun and moon, then each planet added
+  static const char *names[] = { "sun", "moon", "venus", "mars", "jupiter" };
+  double last_ns = 0;
+  unsigned long last_lookups = 0;
+  int count;
+  for (count = 1; count <= SKY_BODY_COUNT; count++) {
+    unsigned long body_lookups;
+    double ns = time_bodies(count, &body_lookups);
+    printf("batched engine, up to %-7s: %.2f us, %lu trig lookups per day table (+%.2f us, +%lu for this body)\n",
+           names[count - 1], ns / 1e3, body_lookups, (ns - last_ns) / 1e3, body_lookups - last_lookups);
+    last_ns = ns;
+    last_lookups = body_lookups;
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include "pebble.h"
+//
+// Host versions of the Pebble trig lookups.  Like the firmware they read
+// precomputed tables rather than calling libm, so timings stay comparable,
+// and they return the same integer grid: sin/cos take TRIG_MAX_ANGLE steps
+// (a quarter-wave table with one entry per step) and return TRIG_MAX_RATIO
+// fractions, atan2 returns [0, TRIG_MAX_ANGLE) from an arctangent table over
+// [0,1] for the first octant.
+//
+
+#define QUARTER_TURN (TRIG_MAX_ANGLE / 4)
+#define ATAN_STEPS 4096
+
+static uint16_t s_sin_table[QUARTER_TURN + 1];
+static uint16_t s_atan_table[ATAN_STEPS + 1];
+static bool s_tables_ready;
+
+unsigned long host_trig_lookups;
+
+static void build_tables(void) {
+  int i;
+  for (i = 0; i <= QUARTER_TURN; i++) {
+    s_sin_table[i] = (uint16_t)lround(sin(2 * M_PI * i / TRIG_MAX_ANGLE) * TRIG_MAX_RATIO);
+  }
+  for (i = 0; i <= ATAN_STEPS; i++) {
+    s_atan_table[i] = (uint16_t)lround(atan((double)i / ATAN_STEPS) / (2 * M_PI) * TRIG_MAX_ANGLE);
+  }
+  s_tables_ready = true;
+}
+
+int32_t sin_lookup(int32_t angle) {
+  if (!s_tables_ready) build_tables();
+  host_trig_lookups++;
+  angle &= TRIG_MAX_ANGLE - 1;
+  if (angle <= QUARTER_TURN) return s_sin_table[angle];
+  if (angle <= 2 * QUARTER_TURN) return s_sin_table[2 * QUARTER_TURN - angle];
+  if (angle <= 3 * QUARTER_TURN) return -s_sin_table[angle - 2 * QUARTER_TURN];
+  return -s_sin_table[TRIG_MAX_ANGLE - angle];
+}
+
+int32_t cos_lookup(int32_t angle) {
+  return sin_lookup(angle + QUARTER_TURN);
+}
+
+int32_t atan2_lookup(int16_t y, int16_t x) {
+  // result is in [0, TRIG_MAX_ANGLE), as on the watch
+  if (!s_tables_ready) build_tables();
+  host_trig_lookups++;
+  int32_t ax = x < 0 ? -x : x;
+  int32_t ay = y < 0 ? -y : y;
+  int32_t t;
+  if (ax == 0 && ay == 0) return 0;
+  if (ay <= ax) {
+    t = s_atan_table[(ay * ATAN_STEPS + ax / 2) / ax];
+  }
+  else {
+    t = QUARTER_TURN - s_atan_table[(ax * ATAN_STEPS + ay / 2) / ay];
+  }
+  if (x < 0) t = 2 * QUARTER_TURN - t;
+  if (y < 0) t = TRIG_MAX_ANGLE - t;
+  return t & (TRIG_MAX_ANGLE - 1);
+}
+
+bool host_app_log_enabled;
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...) {
+  if (!host_app_log_enabled) return;
+  va_list args;
+  va_start(args, fmt);
+  fprintf(stderr, "[%d] %s:%d ", log_level, src_filename, src_line_number);
+  vfprintf(stderr, fmt, args);
+  fputc('\n', stderr);
+  va_end(args);
+}
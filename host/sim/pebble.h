@@ -0,0 +1,325 @@
+#pragma once
+//
+// Stand-in for the Pebble SDK header that the whole watchface builds
+// against, for the headless simulator (simulate.c).  On top of the trig
+// lookups and logging of ../pebble.h it has the window, layer, text, bitmap,
+// tick timer, app timer, persist, AppMessage, tap, Quick View and worker
+// calls the face makes.
+// pebble_sim.c implements them: drawing only counts, persist is kept in
+// memory, and time is the simulated clock.
+//
+// The simulated watch is a basalt: 144x168, colour, rectangular.
+//
+#include "../pebble.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifndef PBL_COLOR
+#define PBL_COLOR
+#endif
+#define PBL_IF_COLOR_ELSE(if_true, if_false) (if_true)
+#define PBL_IF_ROUND_ELSE(if_true, if_false) (if_false)
+
+#define SIM_SCREEN_WIDTH 144
+#define SIM_SCREEN_HEIGHT 168
+
+// status codes
+#define S_SUCCESS 0
+#define E_INVALID_ARGUMENT -4
+#define E_DOES_NOT_EXIST -9
+
+// geometry and colour
+
+typedef struct GPoint {
+  int16_t x, y;
+} GPoint;
+#define GPoint(x, y) ((GPoint){(x), (y)})
+
+typedef struct GSize {
+  int16_t w, h;
+} GSize;
+#define GSize(w, h) ((GSize){(w), (h)})
+
+typedef struct GRect {
+  GPoint origin;
+  GSize size;
+} GRect;
+#define GRect(x, y, w, h) ((GRect){{(x), (y)}, {(w), (h)}})
+#define GRectZero GRect(0, 0, 0, 0)
+
+typedef union GColor8 {
+  uint8_t argb;
+} GColor8;
+typedef GColor8 GColor;
+#define GColorBlack ((GColor8){.argb = 0xc0})
+#define GColorWhite ((GColor8){.argb = 0xff})
+#define GColorDarkGray ((GColor8){.argb = 0xd5})
+#define GColorLightGray ((GColor8){.argb = 0xea})
+#define GColorRed ((GColor8){.argb = 0xf0})
+#define GColorOrange ((GColor8){.argb = 0xf4})
+#define GColorYellow ((GColor8){.argb = 0xfc})
+#define GColorClear ((GColor8){.argb = 0x00})
+
+typedef enum {
+  GCompOpAssign,
+  GCompOpAssignInverted,
+  GCompOpOr,
+  GCompOpAnd,
+  GCompOpClear,
+  GCompOpSet
+} GCompOp;
+
+typedef enum {
+  GTextAlignmentLeft,
+  GTextAlignmentCenter,
+  GTextAlignmentRight
+} GTextAlignment;
+
+// drawing, which is counted rather than done
+
+typedef struct GContext GContext;
+typedef struct GBitmap GBitmap;
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color);
+void graphics_context_set_fill_color(GContext *ctx, GColor color);
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width);
+void graphics_context_set_antialiased(GContext *ctx, bool enable);
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode);
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1);
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius);
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius);
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect);
+
+// resources, with the sizes of the images in resources/images
+
+enum {
+  RESOURCE_ID_IMAGE_THUMBNAIL = 1,
+  RESOURCE_ID_IMAGE_SUN_RISEN,
+  RESOURCE_ID_IMAGE_MOON9,
+  RESOURCE_ID_IMAGE_MOON8,
+  RESOURCE_ID_IMAGE_MOON7,
+  RESOURCE_ID_IMAGE_MOON6,
+  RESOURCE_ID_IMAGE_MOON5,
+  RESOURCE_ID_IMAGE_MOON4,
+  RESOURCE_ID_IMAGE_MOON3,
+  RESOURCE_ID_IMAGE_MOON2,
+  RESOURCE_ID_IMAGE_MOON1,
+  RESOURCE_ID_IMAGE_HORIZON,
+  RESOURCE_ID_IMAGE_SUN_RIM
+};
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id);
+void gbitmap_destroy(GBitmap *bitmap);
+
+// fonts
+
+typedef struct GFontSim *GFont;
+#define FONT_KEY_BITHAM_42_BOLD "RESOURCE_ID_BITHAM_42_BOLD"
+#define FONT_KEY_GOTHIC_24_BOLD "RESOURCE_ID_GOTHIC_24_BOLD"
+GFont fonts_get_system_font(const char *font_key);
+
+// layers and windows; a dirty layer has its whole window redrawn, as on
+// the watch
+
+typedef struct Layer Layer;
+typedef struct TextLayer TextLayer;
+typedef struct Window Window;
+typedef void (*LayerUpdateProc)(Layer *layer, GContext *ctx);
+
+Layer *layer_create(GRect frame);
+void layer_destroy(Layer *layer);
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc);
+void layer_add_child(Layer *parent, Layer *child);
+GRect layer_get_bounds(const Layer *layer);
+GRect layer_get_frame(const Layer *layer);
+void layer_set_frame(Layer *layer, GRect frame);
+void layer_set_hidden(Layer *layer, bool hidden);
+void layer_mark_dirty(Layer *layer);
+// the layer's bounds less what a Quick View peek covers
+GRect layer_get_unobstructed_bounds(const Layer *layer);
+
+TextLayer *text_layer_create(GRect frame);
+void text_layer_destroy(TextLayer *text_layer);
+Layer *text_layer_get_layer(TextLayer *text_layer);
+void text_layer_set_text(TextLayer *text_layer, const char *text);
+void text_layer_set_font(TextLayer *text_layer, GFont font);
+void text_layer_set_text_color(TextLayer *text_layer, GColor color);
+void text_layer_set_background_color(TextLayer *text_layer, GColor color);
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment);
+
+typedef void (*WindowHandler)(Window *window);
+typedef struct WindowHandlers {
+  WindowHandler load;
+  WindowHandler appear;
+  WindowHandler disappear;
+  WindowHandler unload;
+} WindowHandlers;
+
+Window *window_create(void);
+void window_destroy(Window *window);
+void window_set_window_handlers(Window *window, WindowHandlers handlers);
+void window_stack_push(Window *window, bool animated);
+Layer *window_get_root_layer(const Window *window);
+void window_set_background_color(Window *window, GColor background_color);
+
+// time, from the simulated clock
+
+typedef enum {
+  SECOND_UNIT = 1 << 0,
+  MINUTE_UNIT = 1 << 1,
+  HOUR_UNIT = 1 << 2,
+  DAY_UNIT = 1 << 3,
+  MONTH_UNIT = 1 << 4,
+  YEAR_UNIT = 1 << 5
+} TimeUnits;
+
+typedef void (*TickHandler)(struct tm *tick_time, TimeUnits units_changed);
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler);
+
+time_t sim_time(time_t *tloc);
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms);
+bool clock_is_24h_style(void);
+
+typedef struct AppTimer AppTimer;
+typedef void (*AppTimerCallback)(void *data);
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data);
+void app_timer_cancel(AppTimer *timer);
+
+void app_event_loop(void);
+
+// memory, counted so the peak heap can be reported
+
+void *sim_malloc(size_t size) __attribute__((malloc, alloc_size(1)));
+void sim_free(void *ptr);
+size_t heap_bytes_used(void);
+size_t heap_bytes_free(void);
+
+// persistent storage, in memory
+
+#define PERSIST_DATA_MAX_LENGTH 256
+bool persist_exists(const uint32_t key);
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size);
+int persist_write_data(const uint32_t key, const void *data, const size_t size);
+int persist_delete(const uint32_t key);
+
+// AppMessage; the inbox is fed from the script, the outbox is counted and
+// acknowledged
+
+typedef enum {
+  TUPLE_BYTE_ARRAY = 0,
+  TUPLE_CSTRING = 1,
+  TUPLE_UINT = 2,
+  TUPLE_INT = 3
+} TupleType;
+
+#define SIM_TUPLE_BYTES 128
+typedef struct Tuple {
+  uint32_t key;
+  TupleType type;
+  uint16_t length;
+  union {
+    uint8_t data[SIM_TUPLE_BYTES];
+    char cstring[SIM_TUPLE_BYTES];
+    int8_t int8;
+    uint8_t uint8;
+    int16_t int16;
+    uint16_t uint16;
+    int32_t int32;
+    uint32_t uint32;
+  } value[1];
+} Tuple;
+
+#define SIM_DICT_TUPLES 16
+typedef struct DictionaryIterator {
+  Tuple tuples[SIM_DICT_TUPLES];
+  int count;
+} DictionaryIterator;
+
+typedef enum {
+  DICT_OK = 0,
+  DICT_NOT_ENOUGH_STORAGE = 1 << 1
+} DictionaryResult;
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key);
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value);
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t *data, const uint16_t size);
+
+typedef enum {
+  APP_MSG_OK = 0,
+  APP_MSG_SEND_TIMEOUT = 1 << 1,
+  APP_MSG_BUSY = 1 << 10
+} AppMessageResult;
+
+typedef void (*AppMessageInboxReceived)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageOutboxSent)(DictionaryIterator *iterator, void *context);
+typedef void (*AppMessageOutboxFailed)(DictionaryIterator *iterator, AppMessageResult reason, void *context);
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound);
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback);
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback);
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback);
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator);
+AppMessageResult app_message_outbox_send(void);
+
+// message keys, numbered as in package.json
+extern uint32_t MESSAGE_KEY_Latitude, MESSAGE_KEY_Longitude, MESSAGE_KEY_ShowInfo,
+  MESSAGE_KEY_PhoneEphemeris, MESSAGE_KEY_AutoLocation, MESSAGE_KEY_SkyPhoneReady,
+  MESSAGE_KEY_SkyRequest, MESSAGE_KEY_SkyDays, MESSAGE_KEY_SkyLatitude, MESSAGE_KEY_SkyLongitude,
+  MESSAGE_KEY_SkyDay, MESSAGE_KEY_SkyChunkIndex, MESSAGE_KEY_SkyChunkCount, MESSAGE_KEY_SkyChunk,
+  MESSAGE_KEY_ProfileIndex, MESSAGE_KEY_ProfileCount, MESSAGE_KEY_ProfileCounters, MESSAGE_KEY_ProfileEntries,
+  MESSAGE_KEY_LocationFix, MESSAGE_KEY_BackgroundWorker;
+
+// taps, from the script
+
+typedef enum {
+  ACCEL_AXIS_X = 0,
+  ACCEL_AXIS_Y = 1,
+  ACCEL_AXIS_Z = 2
+} AccelAxisType;
+typedef void (*AccelTapHandler)(AccelAxisType axis, int32_t direction);
+
+void accel_tap_service_subscribe(AccelTapHandler handler);
+void accel_tap_service_unsubscribe(void);
+
+// Quick View peeks, from the script
+
+typedef int32_t AnimationProgress;
+#define ANIMATION_NORMALIZED_MAX 65535
+
+typedef void (*UnobstructedAreaWillChangeHandler)(GRect final_unobstructed_screen_area, void *context);
+typedef void (*UnobstructedAreaChangeHandler)(AnimationProgress progress, void *context);
+typedef void (*UnobstructedAreaDidChangeHandler)(void *context);
+typedef struct UnobstructedAreaHandlers {
+  UnobstructedAreaWillChangeHandler will_change;
+  UnobstructedAreaChangeHandler change;
+  UnobstructedAreaDidChangeHandler did_change;
+} UnobstructedAreaHandlers;
+
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers, void *context);
+void unobstructed_area_service_unsubscribe(void);
+
+// the background worker, which the simulator doesn't run
+
+typedef struct AppWorkerMessage {
+  uint16_t data0, data1, data2;
+} AppWorkerMessage;
+typedef void (*AppWorkerMessageHandler)(uint16_t type, AppWorkerMessage *data);
+
+typedef enum {
+  APP_WORKER_RESULT_SUCCESS = 0,
+  APP_WORKER_RESULT_NO_WORKER = 1
+} AppWorkerResult;
+
+bool app_worker_is_running(void);
+AppWorkerResult app_worker_launch(void);
+AppWorkerResult app_worker_kill(void);
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler);
+void app_worker_send_message(uint8_t type, AppWorkerMessage *data);
+
+// the face's sources see the simulated clock and heap; pebble_sim.c sees
+// the real ones
+#ifndef SIM_INTERNAL
+#define time(tloc) sim_time(tloc)
+#define malloc(size) sim_malloc(size)
+#define free(ptr) sim_free(ptr)
+#endif
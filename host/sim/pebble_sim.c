@@ -0,0 +1,801 @@
+#define SIM_INTERNAL
+#include "pebble.h"
+#include "pebble_sim.h"
+//
+// The simulated watch behind sim/pebble.h
+//
+// app_event_loop() runs the simulation: from the start time it hands out,
+// in time order, minute ticks, app timers that have come due, the script's
+// inbox messages, taps and peeks and outbox acknowledgements, and after each of them draws
+// the window if anything marked it dirty.  The clock jumps from one event to
+// the next, but runs at real speed inside a handler, so the face's own
+// time_ms() measurements still mean something.
+//
+
+#define SIM_OUTBOX_ACK_MS 200   // time the phone takes to acknowledge a message
+#define SIM_PERSIST_KEYS 32
+#define SIM_SCRIPT_MESSAGES 256
+#define SIM_LAYER_CHILDREN 8
+#define SIM_PEEK_HEIGHT 51      // a Quick View peek on a rectangular watch
+#define SIM_PEEK_FRAMES 10      // change callbacks as it slides in or out
+#define SIM_PEEK_FRAME_MS 30
+
+SimStats sim_stats;
+
+static int64_t s_start_ms;       // simulated clock, ms since the epoch
+static int64_t s_end_ms;
+static int64_t s_now_ms;
+static struct timespec s_dispatch_start;   // real time the current handler started
+static bool s_dispatching;
+
+static double real_seconds(const struct timespec *t) {
+  return t->tv_sec + t->tv_nsec / 1e9;
+}
+
+static double real_since(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return real_seconds(&now) - real_seconds(start);
+}
+
+static int64_t now_ms(void) {
+  if (!s_dispatching) return s_now_ms;
+  return s_now_ms + (int64_t)(real_since(&s_dispatch_start) * 1000);
+}
+
+// time
+
+time_t sim_time(time_t *tloc) {
+  time_t t = (time_t)(now_ms() / 1000);
+  if (tloc) *tloc = t;
+  return t;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms) {
+  int64_t ms = now_ms();
+  if (tloc) *tloc = (time_t)(ms / 1000);
+  if (out_ms) *out_ms = (uint16_t)(ms % 1000);
+  return (uint16_t)(ms % 1000);
+}
+
+bool clock_is_24h_style(void) {
+  return true;
+}
+
+// heap
+
+typedef struct SimBlock {
+  size_t size;
+  max_align_t align;
+} SimBlock;
+
+void *sim_malloc(size_t size) {
+  SimBlock *block = malloc(sizeof(SimBlock) + size);
+  if (!block) return NULL;
+  block->size = size;
+  sim_stats.heap_used += size;
+  if (sim_stats.heap_used > sim_stats.heap_peak) sim_stats.heap_peak = sim_stats.heap_used;
+  return block + 1;
+}
+
+void sim_free(void *ptr) {
+  if (!ptr) return;
+  SimBlock *block = (SimBlock *)ptr - 1;
+  sim_stats.heap_used -= block->size;
+  free(block);
+}
+
+size_t heap_bytes_used(void) {
+  return sim_stats.heap_used;
+}
+
+size_t heap_bytes_free(void) {
+  return SIM_HEAP_BYTES - sim_stats.heap_used;
+}
+
+// drawing
+
+struct GContext {
+  int unused;
+};
+
+struct GBitmap {
+  uint32_t resource_id;
+  GSize size;
+  uint8_t *pixels;
+};
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {}
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {}
+void graphics_context_set_stroke_width(GContext *ctx, uint8_t stroke_width) {}
+void graphics_context_set_antialiased(GContext *ctx, bool enable) {}
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  sim_stats.lines++;
+}
+
+void graphics_draw_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  sim_stats.circles++;
+}
+
+void graphics_fill_circle(GContext *ctx, GPoint p, uint16_t radius) {
+  sim_stats.circles++;
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect) {
+  sim_stats.bitmaps_drawn++;
+}
+
+static GSize resource_size(uint32_t resource_id) {
+  switch (resource_id) {
+    case RESOURCE_ID_IMAGE_THUMBNAIL: return GSize(25, 25);
+    case RESOURCE_ID_IMAGE_HORIZON: return GSize(4, 7);
+    case RESOURCE_ID_IMAGE_SUN_RISEN:
+    case RESOURCE_ID_IMAGE_SUN_RIM: return GSize(15, 13);
+    default: return GSize(13, 13);
+  }
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+  // 8 bits a pixel, as on basalt
+  GBitmap *bitmap = sim_malloc(sizeof(GBitmap));
+  bitmap->resource_id = resource_id;
+  bitmap->size = resource_size(resource_id);
+  bitmap->pixels = sim_malloc(bitmap->size.w * bitmap->size.h);
+  sim_stats.bitmap_loads++;
+  return bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if (!bitmap) return;
+  sim_free(bitmap->pixels);
+  sim_free(bitmap);
+  sim_stats.bitmap_destroys++;
+}
+
+GFont fonts_get_system_font(const char *font_key) {
+  return (GFont)font_key;
+}
+
+// layers and windows
+
+struct Layer {
+  GRect frame;
+  bool hidden;
+  LayerUpdateProc update_proc;
+  Layer *children[SIM_LAYER_CHILDREN];
+  int child_count;
+};
+
+struct TextLayer {
+  Layer layer;
+  const char *text;
+};
+
+struct Window {
+  Layer root;
+  WindowHandlers handlers;
+  bool loaded;
+};
+
+static Window *s_window;        // the one on the stack
+static bool s_window_dirty;
+static int s_unobstructed_h = SIM_SCREEN_HEIGHT;   // the screen above any peek
+static bool s_peek_moving;
+
+Layer *layer_create(GRect frame) {
+  Layer *layer = sim_malloc(sizeof(Layer));
+  *layer = (Layer){ .frame = frame };
+  return layer;
+}
+
+void layer_destroy(Layer *layer) {
+  sim_free(layer);
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  if (parent->child_count < SIM_LAYER_CHILDREN) parent->children[parent->child_count++] = child;
+  s_window_dirty = true;
+}
+
+GRect layer_get_bounds(const Layer *layer) {
+  return GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+}
+
+GRect layer_get_frame(const Layer *layer) {
+  return layer->frame;
+}
+
+void layer_set_frame(Layer *layer, GRect frame) {
+  if (memcmp(&layer->frame, &frame, sizeof(GRect)) == 0) return;
+  layer->frame = frame;
+  s_window_dirty = true;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+  if (layer->hidden == hidden) return;
+  layer->hidden = hidden;
+  s_window_dirty = true;
+}
+
+// as if the layer were at the top of the screen, which the face's root is
+GRect layer_get_unobstructed_bounds(const Layer *layer) {
+  GRect bounds = layer_get_bounds(layer);
+  if (bounds.size.h > s_unobstructed_h) bounds.size.h = s_unobstructed_h;
+  return bounds;
+}
+
+void layer_mark_dirty(Layer *layer) {
+  s_window_dirty = true;
+  sim_stats.dirty_marks++;
+}
+
+TextLayer *text_layer_create(GRect frame) {
+  TextLayer *text_layer = sim_malloc(sizeof(TextLayer));
+  *text_layer = (TextLayer){ .layer = { .frame = frame } };
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer) {
+  sim_free(text_layer);
+}
+
+Layer *text_layer_get_layer(TextLayer *text_layer) {
+  return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text) {
+  text_layer->text = text;
+  s_window_dirty = true;
+  sim_stats.text_updates++;
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font) {}
+void text_layer_set_text_color(TextLayer *text_layer, GColor color) {}
+void text_layer_set_background_color(TextLayer *text_layer, GColor color) {}
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment) {}
+
+Window *window_create(void) {
+  Window *window = sim_malloc(sizeof(Window));
+  *window = (Window){ .root = { .frame = GRect(0, 0, SIM_SCREEN_WIDTH, SIM_SCREEN_HEIGHT) } };
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if (window->loaded && window->handlers.unload) window->handlers.unload(window);
+  if (s_window == window) s_window = NULL;
+  sim_free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  s_window = window;
+  if (!window->loaded) {
+    window->loaded = true;
+    if (window->handlers.load) window->handlers.load(window);
+  }
+  if (window->handlers.appear) window->handlers.appear(window);
+  s_window_dirty = true;
+}
+
+Layer *window_get_root_layer(const Window *window) {
+  return (Layer *)&window->root;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {}
+
+static void draw_layer(Layer *layer, GContext *ctx) {
+  int i;
+  if (layer->hidden) return;
+  if (layer->update_proc) layer->update_proc(layer, ctx);
+  for (i=0;i<layer->child_count;i++) draw_layer(layer->children[i], ctx);
+}
+
+// the whole window, if anything in it changed
+static void draw_window(void) {
+  GContext ctx;
+  struct timespec start;
+  if (!s_window || !s_window_dirty) return;
+  s_window_dirty = false;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  s_dispatch_start = start;
+  s_dispatching = true;
+  draw_layer(&s_window->root, &ctx);
+  s_dispatching = false;
+  sim_stats.frames.count++;
+  sim_stats.frames.seconds += real_since(&start);
+  if (s_peek_moving) {
+    sim_stats.peek_frames.count++;
+    sim_stats.peek_frames.seconds += real_since(&start);
+  }
+}
+
+// persistent storage
+
+typedef struct SimPersist {
+  bool used;
+  uint32_t key;
+  size_t size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} SimPersist;
+
+static SimPersist s_persist[SIM_PERSIST_KEYS];
+
+static SimPersist *persist_find(uint32_t key) {
+  int i;
+  for (i=0;i<SIM_PERSIST_KEYS;i++) {
+    if (s_persist[i].used && (s_persist[i].key == key)) return &s_persist[i];
+  }
+  return NULL;
+}
+
+bool persist_exists(const uint32_t key) {
+  return persist_find(key) != NULL;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size) {
+  SimPersist *value = persist_find(key);
+  sim_stats.persist_reads++;
+  if (!value) return E_DOES_NOT_EXIST;
+  size_t size = (value->size < buffer_size) ? value->size : buffer_size;
+  memcpy(buffer, value->data, size);
+  return (int)size;
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size) {
+  SimPersist *value = persist_find(key);
+  int i;
+  if (size > PERSIST_DATA_MAX_LENGTH) return E_INVALID_ARGUMENT;
+  for (i=0;!value && (i<SIM_PERSIST_KEYS);i++) {
+    if (!s_persist[i].used) value = &s_persist[i];
+  }
+  if (!value) return E_INVALID_ARGUMENT;
+  value->used = true;
+  value->key = key;
+  value->size = size;
+  memcpy(value->data, data, size);
+  sim_stats.persist_writes++;
+  sim_stats.persist_bytes_written += size;
+  return (int)size;
+}
+
+int persist_delete(const uint32_t key) {
+  SimPersist *value = persist_find(key);
+  if (!value) return E_DOES_NOT_EXIST;
+  value->used = false;
+  sim_stats.persist_deletes++;
+  return S_SUCCESS;
+}
+
+// timers, kept in the order they come due; the outbox acknowledgement and
+// the peeks' frames are some too, but aren't counted with the face's
+
+struct AppTimer {
+  int64_t due_ms;
+  AppTimerCallback callback;
+  void *data;
+  SimCost *cost;
+  AppTimer *next;
+};
+
+static AppTimer *s_timers;
+
+static AppTimer *add_timer(uint32_t timeout_ms, AppTimerCallback callback, void *data, SimCost *cost) {
+  AppTimer *timer = malloc(sizeof(AppTimer));
+  AppTimer **p = &s_timers;
+  timer->due_ms = now_ms() + timeout_ms;
+  timer->callback = callback;
+  timer->data = data;
+  timer->cost = cost;
+  while (*p && ((*p)->due_ms <= timer->due_ms)) p = &(*p)->next;
+  timer->next = *p;
+  *p = timer;
+  return timer;
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data) {
+  return add_timer(timeout_ms, callback, callback_data, &sim_stats.timers);
+}
+
+void app_timer_cancel(AppTimer *timer) {
+  AppTimer **p = &s_timers;
+  while (*p && (*p != timer)) p = &(*p)->next;
+  if (!*p) return;
+  *p = timer->next;
+  free(timer);
+}
+
+// ticks
+
+static TickHandler s_tick_handler;
+static TimeUnits s_tick_units;
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler) {
+  s_tick_units = tick_units;
+  s_tick_handler = handler;
+}
+
+// taps
+
+static AccelTapHandler s_accel_tap_handler;
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {
+  s_accel_tap_handler = handler;
+}
+
+void accel_tap_service_unsubscribe(void) {
+  s_accel_tap_handler = NULL;
+}
+
+// Quick View peeks: the unobstructed area slides to or from the peek's
+// height over SIM_PEEK_FRAMES change callbacks, as on the watch
+
+static UnobstructedAreaHandlers s_unobstructed_handlers;
+static void *s_unobstructed_context;
+static int s_peek_from_h, s_peek_to_h;
+static int s_peek_frame;
+
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers, void *context) {
+  s_unobstructed_handlers = handlers;
+  s_unobstructed_context = context;
+}
+
+void unobstructed_area_service_unsubscribe(void) {
+  s_unobstructed_handlers = (UnobstructedAreaHandlers){ 0 };
+}
+
+static void peek_frame(void *data) {
+  AnimationProgress progress = (AnimationProgress)(++s_peek_frame * (int64_t)ANIMATION_NORMALIZED_MAX / SIM_PEEK_FRAMES);
+  s_unobstructed_h = s_peek_from_h + (s_peek_to_h - s_peek_from_h) * s_peek_frame / SIM_PEEK_FRAMES;
+  if (s_unobstructed_handlers.change) s_unobstructed_handlers.change(progress, s_unobstructed_context);
+  if (s_peek_frame < SIM_PEEK_FRAMES) {
+    add_timer(SIM_PEEK_FRAME_MS, peek_frame, NULL, &sim_stats.peeks);
+    return;
+  }
+  s_peek_moving = false;
+  if (s_unobstructed_handlers.did_change) s_unobstructed_handlers.did_change(s_unobstructed_context);
+}
+
+// start the peek sliding in, or out; the handler calls are timed by the caller
+static void start_peek(bool shown) {
+  int to_h = shown ? SIM_SCREEN_HEIGHT - SIM_PEEK_HEIGHT : SIM_SCREEN_HEIGHT;
+  if (s_peek_moving || (to_h == s_unobstructed_h)) return;
+  s_peek_from_h = s_unobstructed_h;
+  s_peek_to_h = to_h;
+  s_peek_frame = 0;
+  s_peek_moving = true;
+  if (s_unobstructed_handlers.will_change) {
+    s_unobstructed_handlers.will_change(GRect(0, 0, SIM_SCREEN_WIDTH, to_h), s_unobstructed_context);
+  }
+  add_timer(SIM_PEEK_FRAME_MS, peek_frame, NULL, &sim_stats.peeks);
+}
+
+// AppMessage
+
+uint32_t MESSAGE_KEY_Latitude = 10000, MESSAGE_KEY_Longitude = 10001, MESSAGE_KEY_ShowInfo = 10002,
+  MESSAGE_KEY_PhoneEphemeris = 10003, MESSAGE_KEY_AutoLocation = 10004, MESSAGE_KEY_SkyPhoneReady = 10005,
+  MESSAGE_KEY_SkyRequest = 10006, MESSAGE_KEY_SkyDays = 10007, MESSAGE_KEY_SkyLatitude = 10008,
+  MESSAGE_KEY_SkyLongitude = 10009, MESSAGE_KEY_SkyDay = 10010, MESSAGE_KEY_SkyChunkIndex = 10011,
+  MESSAGE_KEY_SkyChunkCount = 10012, MESSAGE_KEY_SkyChunk = 10013, MESSAGE_KEY_ProfileIndex = 10014,
+  MESSAGE_KEY_ProfileCount = 10015, MESSAGE_KEY_ProfileCounters = 10016, MESSAGE_KEY_ProfileEntries = 10017,
+  MESSAGE_KEY_LocationFix = 10018, MESSAGE_KEY_BackgroundWorker = 10019;
+
+static const struct {
+  const char *name;
+  uint32_t *key;
+} s_key_names[] = {
+  { "Latitude", &MESSAGE_KEY_Latitude },
+  { "Longitude", &MESSAGE_KEY_Longitude },
+  { "ShowInfo", &MESSAGE_KEY_ShowInfo },
+  { "PhoneEphemeris", &MESSAGE_KEY_PhoneEphemeris },
+  { "AutoLocation", &MESSAGE_KEY_AutoLocation },
+  { "SkyPhoneReady", &MESSAGE_KEY_SkyPhoneReady },
+  { "LocationFix", &MESSAGE_KEY_LocationFix },
+  { "BackgroundWorker", &MESSAGE_KEY_BackgroundWorker },
+};
+
+static AppMessageInboxReceived s_inbox_received;
+static AppMessageOutboxSent s_outbox_sent;
+static AppMessageOutboxFailed s_outbox_failed;
+static DictionaryIterator s_outbox;
+static bool s_outbox_open;      // begun but not sent
+static bool s_outbox_busy;      // sent but not acknowledged
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  int i;
+  for (i=0;i<iter->count;i++) {
+    if (iter->tuples[i].key == key) return (Tuple *)&iter->tuples[i];
+  }
+  return NULL;
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key, const int32_t value) {
+  if (iter->count >= SIM_DICT_TUPLES) return DICT_NOT_ENOUGH_STORAGE;
+  Tuple *tuple = &iter->tuples[iter->count++];
+  tuple->key = key;
+  tuple->type = TUPLE_INT;
+  tuple->length = sizeof(int32_t);
+  tuple->value->int32 = value;
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key, const uint8_t *data, const uint16_t size) {
+  if ((iter->count >= SIM_DICT_TUPLES) || (size > SIM_TUPLE_BYTES)) return DICT_NOT_ENOUGH_STORAGE;
+  Tuple *tuple = &iter->tuples[iter->count++];
+  tuple->key = key;
+  tuple->type = TUPLE_BYTE_ARRAY;
+  tuple->length = size;
+  memcpy(tuple->value->data, data, size);
+  return DICT_OK;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound, const uint32_t size_outbound) {
+  return APP_MSG_OK;
+}
+
+AppMessageInboxReceived app_message_register_inbox_received(AppMessageInboxReceived received_callback) {
+  AppMessageInboxReceived previous = s_inbox_received;
+  s_inbox_received = received_callback;
+  return previous;
+}
+
+AppMessageOutboxSent app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+  AppMessageOutboxSent previous = s_outbox_sent;
+  s_outbox_sent = sent_callback;
+  return previous;
+}
+
+AppMessageOutboxFailed app_message_register_outbox_failed(AppMessageOutboxFailed failed_callback) {
+  AppMessageOutboxFailed previous = s_outbox_failed;
+  s_outbox_failed = failed_callback;
+  return previous;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  if (s_outbox_open || s_outbox_busy) return APP_MSG_BUSY;
+  s_outbox.count = 0;
+  s_outbox_open = true;
+  *iterator = &s_outbox;
+  return APP_MSG_OK;
+}
+
+static void outbox_acknowledged(void *data) {
+  s_outbox_busy = false;
+  if (s_outbox_sent) s_outbox_sent(&s_outbox, NULL);
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  int i;
+  if (!s_outbox_open) return APP_MSG_BUSY;
+  s_outbox_open = false;
+  s_outbox_busy = true;
+  sim_stats.outbox_messages++;
+  for (i=0;i<s_outbox.count;i++) sim_stats.outbox_bytes += s_outbox.tuples[i].length;
+  add_timer(SIM_OUTBOX_ACK_MS, outbox_acknowledged, NULL, &sim_stats.outbox);
+  return APP_MSG_OK;
+}
+
+// the worker isn't simulated: the face does all its own calculating
+
+bool app_worker_is_running(void) {
+  return false;
+}
+
+AppWorkerResult app_worker_launch(void) {
+  return APP_WORKER_RESULT_NO_WORKER;
+}
+
+AppWorkerResult app_worker_kill(void) {
+  return APP_WORKER_RESULT_NO_WORKER;
+}
+
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler) {
+  return true;
+}
+
+void app_worker_send_message(uint8_t type, AppWorkerMessage *data) {}
+
+// the script: lines of "day hh:mm Key=value ...", the day counted from the
+// start, values as the phone sends them (hundredths of a degree for the
+// location); # starts a comment.  Tap=n is n taps instead, a second apart,
+// and Peek=1 or Peek=0 slides a Quick View peek in or out.
+
+#define SIM_TAP_GAP_MS 1000
+
+typedef struct SimMessage {
+  int64_t at_ms;
+  bool tap;
+  bool peek;
+  bool peek_shown;
+  DictionaryIterator dict;
+} SimMessage;
+
+static SimMessage s_script[SIM_SCRIPT_MESSAGES];
+static int s_script_count;
+static int s_script_next;
+
+static uint32_t *find_key(const char *name) {
+  size_t i;
+  for (i=0;i<sizeof(s_key_names)/sizeof(s_key_names[0]);i++) {
+    if (strcmp(s_key_names[i].name, name) == 0) return s_key_names[i].key;
+  }
+  return NULL;
+}
+
+// add to the script, keeping it in time order
+static void add_message(const SimMessage *message) {
+  if (s_script_count >= SIM_SCRIPT_MESSAGES) return;
+  int i = s_script_count++;
+  s_script[i] = *message;
+  while ((i > 0) && (s_script[i-1].at_ms > s_script[i].at_ms)) {
+    SimMessage swap = s_script[i];
+    s_script[i] = s_script[i-1];
+    s_script[i-1] = swap;
+    i--;
+  }
+}
+
+bool sim_load_script(const char *path) {
+  FILE *file = fopen(path, "r");
+  char line[256];
+  int line_number = 0;
+  if (!file) {
+    fprintf(stderr, "Can't open %s\n", path);
+    return false;
+  }
+  while (fgets(line, sizeof(line), file)) {
+    int day, hour, minute, used;
+    char *p = line;
+    line_number++;
+    if (strchr(line, '#')) *strchr(line, '#') = 0;
+    if (sscanf(p, " %d %d:%d%n", &day, &hour, &minute, &used) != 3) continue;
+    SimMessage message = { 0 };
+    int taps = 0;
+    int peek = -1;
+    // local time on the day, whatever daylight saving is doing
+    time_t start = (time_t)(s_start_ms / 1000);
+    struct tm when = *localtime(&start);
+    when.tm_mday += day;
+    when.tm_hour = hour;
+    when.tm_min = minute;
+    when.tm_sec = 0;
+    when.tm_isdst = -1;
+    message.at_ms = (int64_t)mktime(&when) * 1000;
+    p += used;
+    char name[32];
+    int value;
+    while (sscanf(p, " %31[A-Za-z]=%d%n", name, &value, &used) == 2) {
+      uint32_t *key = find_key(name);
+      p += used;
+      if (strcmp(name, "Tap") == 0) {
+        taps = value;
+        continue;
+      }
+      if (strcmp(name, "Peek") == 0) {
+        peek = value;
+        continue;
+      }
+      if (!key) {
+        fprintf(stderr, "%s:%d: unknown key %s\n", path, line_number, name);
+        fclose(file);
+        return false;
+      }
+      dict_write_int32(&message.dict, *key, value);
+    }
+    if (message.dict.count > 0) add_message(&message);
+    message.dict.count = 0;
+    if (peek >= 0) {
+      SimMessage peek_message = message;
+      peek_message.peek = true;
+      peek_message.peek_shown = peek != 0;
+      add_message(&peek_message);
+    }
+    message.tap = true;
+    while (taps-- > 0) {
+      add_message(&message);
+      message.at_ms += SIM_TAP_GAP_MS;
+    }
+  }
+  fclose(file);
+  return true;
+}
+
+void sim_configure(time_t start, int days) {
+  s_start_ms = (int64_t)start * 1000;
+  s_end_ms = s_start_ms + (int64_t)days * 86400 * 1000;
+  s_now_ms = s_start_ms;
+}
+
+// the event loop
+
+static void dispatch_begin(struct timespec *start) {
+  clock_gettime(CLOCK_MONOTONIC, start);
+  s_dispatch_start = *start;
+  s_dispatching = true;
+}
+
+static void dispatch_end(SimCost *cost, const struct timespec *start) {
+  s_dispatching = false;
+  cost->count++;
+  cost->seconds += real_since(start);
+}
+
+static void run_tick(void) {
+  time_t now = (time_t)(s_now_ms / 1000);
+  struct tm tick_time = *localtime(&now);
+  TimeUnits units = MINUTE_UNIT;
+  struct timespec start;
+  if (tick_time.tm_min == 0) units |= HOUR_UNIT;
+  if ((tick_time.tm_min == 0) && (tick_time.tm_hour == 0)) units |= DAY_UNIT;
+  if (!s_tick_handler || !(units & s_tick_units)) return;
+  dispatch_begin(&start);
+  s_tick_handler(&tick_time, units);
+  dispatch_end(&sim_stats.ticks, &start);
+}
+
+static void run_timer(AppTimer *timer) {
+  struct timespec start;
+  s_timers = timer->next;
+  dispatch_begin(&start);
+  timer->callback(timer->data);
+  dispatch_end(timer->cost, &start);
+  free(timer);
+}
+
+static void run_message(SimMessage *message) {
+  struct timespec start;
+  if (message->peek) {
+    dispatch_begin(&start);
+    start_peek(message->peek_shown);
+    dispatch_end(&sim_stats.peeks, &start);
+    return;
+  }
+  if (message->tap) {
+    if (!s_accel_tap_handler) return;
+    dispatch_begin(&start);
+    s_accel_tap_handler(ACCEL_AXIS_Z, 1);
+    dispatch_end(&sim_stats.taps, &start);
+    return;
+  }
+  if (!s_inbox_received) return;
+  dispatch_begin(&start);
+  s_inbox_received(&message->dict, NULL);
+  dispatch_end(&sim_stats.inbox, &start);
+}
+
+void app_event_loop(void) {
+  int64_t next_tick = (s_now_ms / 60000 + 1) * 60000;
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  draw_window();
+  while (true) {
+    // whichever comes first; a tick before a timer or message due with it
+    int64_t at = next_tick;
+    if (s_timers && (s_timers->due_ms < at)) at = s_timers->due_ms;
+    if ((s_script_next < s_script_count) && (s_script[s_script_next].at_ms < at)) at = s_script[s_script_next].at_ms;
+    if (at >= s_end_ms) break;
+    if (at > s_now_ms) s_now_ms = at;
+
+    if (at == next_tick) {
+      run_tick();
+      next_tick += 60000;
+    }
+    else if (s_timers && (s_timers->due_ms == at)) {
+      run_timer(s_timers);
+    }
+    else {
+      run_message(&s_script[s_script_next++]);
+    }
+    draw_window();
+  }
+  s_now_ms = s_end_ms;
+  sim_stats.wall_seconds = real_since(&start);
+}
@@ -0,0 +1,39 @@
+#pragma once
+//
+// Driving the simulated watch, and what it counted
+//
+
+#define SIM_HEAP_BYTES 24576    // basalt's app heap, near enough
+
+// handler calls of one kind, and the real time they took
+typedef struct SimCost {
+  long count;
+  double seconds;
+} SimCost;
+
+typedef struct SimStats {
+  SimCost ticks;          // tick handler
+  SimCost timers;         // app timer callbacks, the recompute steps
+  SimCost inbox;          // script messages handled
+  SimCost outbox;         // outbox acknowledgements handled
+  SimCost taps;           // tap handler, for the script's taps
+  SimCost peeks;          // unobstructed area handlers, for the script's peeks
+  SimCost frames;         // window redraws
+  SimCost peek_frames;    // the redraws while a peek moved
+  long dirty_marks;       // layer_mark_dirty calls
+  long text_updates;      // text_layer_set_text calls
+  long lines, circles, bitmaps_drawn;
+  long bitmap_loads, bitmap_destroys;
+  long persist_reads, persist_writes, persist_deletes;
+  long persist_bytes_written;
+  long outbox_messages, outbox_bytes;
+  size_t heap_used, heap_peak;
+  double wall_seconds;    // the whole event loop
+} SimStats;
+
+extern SimStats sim_stats;
+
+// start the clock at start and stop the event loop days later
+void sim_configure(time_t start, int days);
+// inbox messages to deliver; after sim_configure, as days count from its start
+bool sim_load_script(const char *path);
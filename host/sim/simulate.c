@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "pebble.h"
+#include "pebble_sim.h"
+//
+// Headless run of the whole watchface
+//
+// src/c/main.c and the rest of the face are built unchanged against
+// sim/pebble.h, with their main() renamed watchface_main(), and run here
+// for a year (or -d days) of simulated minutes, with the inbox messages of
+// a script.  What the face cost is reported at the end: handler calls and
+// the real time they took, redraws, bitmap loads, persist traffic and the
+// peak heap, per day as well as in total, to compare builds by.
+//
+//   simulate [-d days] [-s script] [-t start] [-v]
+//
+// start is a local date, YYYY-MM-DD; TZ sets the time zone (Fairbanks if it
+// isn't set, to go with the default location).  -v shows the face's logs.
+//
+
+int watchface_main(void);
+
+static void report_cost(const char *name, const SimCost *cost, int days, const char *note) {
+  printf("  %-14s %9ld calls %10.1f ms %8.1f calls/day %8.3f ms/day  %s\n", name, cost->count,
+         cost->seconds * 1000, (double)cost->count / days, cost->seconds * 1000 / days, note);
+}
+
+static void report(int days) {
+  const SimStats *s = &sim_stats;
+  long wakeups = s->ticks.count + s->timers.count + s->inbox.count + s->outbox.count +
+                 s->taps.count + s->peeks.count;
+  double handler_seconds = s->ticks.seconds + s->timers.seconds + s->inbox.seconds +
+                           s->outbox.seconds + s->taps.seconds + s->peeks.seconds + s->frames.seconds;
+  printf("Simulated %d days in %.2f s, %.2f s in the face\n", days, s->wall_seconds, handler_seconds);
+  report_cost("ticks", &s->ticks, days, "");
+  report_cost("app timers", &s->timers, days, "recompute and preview steps");
+  report_cost("inbox", &s->inbox, days, "script messages");
+  report_cost("outbox acks", &s->outbox, days, "");
+  report_cost("taps", &s->taps, days, "");
+  if (s->taps.count > 0) {
+    printf("  tap            %.3f ms each\n", s->taps.seconds * 1000 / s->taps.count);
+  }
+  report_cost("peeks", &s->peeks, days, "Quick View handlers");
+  report_cost("redraws", &s->frames, days, "whole window");
+  if (s->peek_frames.count > 0) {
+    printf("  peek redraw    %.3f ms each, %ld while peeks moved\n",
+           s->peek_frames.seconds * 1000 / s->peek_frames.count, s->peek_frames.count);
+  }
+  printf("  wake-ups       %9ld       %.1f a day\n", wakeups, (double)wakeups / days);
+  printf("  drawing        %ld lines, %ld circles, %ld bitmaps; %ld dirty marks, %ld text updates\n",
+         s->lines, s->circles, s->bitmaps_drawn, s->dirty_marks, s->text_updates);
+  printf("  bitmaps        %ld loaded, %ld destroyed\n", s->bitmap_loads, s->bitmap_destroys);
+  printf("  persist        %ld writes (%ld bytes), %ld reads, %ld deletes; %.1f writes a day\n",
+         s->persist_writes, s->persist_bytes_written, s->persist_reads, s->persist_deletes,
+         (double)s->persist_writes / days);
+  printf("  outbox         %ld messages, %ld bytes\n", s->outbox_messages, s->outbox_bytes);
+  printf("  heap           %zu bytes at peak, %zu still in use at exit\n", s->heap_peak, s->heap_used);
+}
+
+int main(int argc, char **argv) {
+  int days = 365;
+  const char *script = NULL;
+  const char *start_date = "2026-01-01";
+  int opt;
+  while ((opt = getopt(argc, argv, "d:s:t:v")) != -1) {
+    switch (opt) {
+      case 'd': days = atoi(optarg); break;
+      case 's': script = optarg; break;
+      case 't': start_date = optarg; break;
+      case 'v': host_app_log_enabled = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-d days] [-s script] [-t YYYY-MM-DD] [-v]\n", argv[0]);
+        return 2;
+    }
+  }
+  if (days < 1) days = 1;
+  setenv("TZ", getenv("TZ") ? getenv("TZ") : "America/Anchorage", 1);
+  tzset();
+
+  struct tm start_tm = { 0 };
+  if (sscanf(start_date, "%d-%d-%d", &start_tm.tm_year, &start_tm.tm_mon, &start_tm.tm_mday) != 3) {
+    fprintf(stderr, "Bad start date %s\n", start_date);
+    return 2;
+  }
+  start_tm.tm_year -= 1900;
+  start_tm.tm_mon -= 1;
+  start_tm.tm_isdst = -1;
+  sim_configure(mktime(&start_tm), days);
+  if (script && !sim_load_script(script)) return 1;
+
+  watchface_main();
+  report(days);
+  return 0;
+}
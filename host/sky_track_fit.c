@@ -0,0 +1,31 @@
+#include "pebble.h"
+#include "sky_track.h"
+#include "sky_track_fit.h"
+
+// difference b - a, the short way round for azimuths
+static float track_delta(float a, float b, bool wrap360) {
+  float d = b - a;
+  if (wrap360) {
+    if (d > 180) d -= 360;
+    if (d < -180) d += 360;
+  }
+  return d;
+}
+
+void sky_track_fit(const float value[], float slope[], int count, bool wrap360) {
+  int i;
+  // centred differences inside (Catmull-Rom), one-sided at the ends
+  slope[0] = track_delta(value[0], value[1], wrap360);
+  for (i=1;i<count-1;i++) {
+    slope[i] = 0.5f * track_delta(value[i-1], value[i+1], wrap360);
+  }
+  slope[count-1] = track_delta(value[count-2], value[count-1], wrap360);
+}
+
+float sky_track_eval(const float value[], const float slope[], int count, float hour, bool wrap360) {
+  int i = (int)hour;
+  if (i < 0) i = 0;
+  if (i > count-2) i = count-2;
+
+  return sky_track_segment(value[i], track_delta(value[i], value[i+1], wrap360), slope[i], slope[i+1], hour - i, wrap360);
+}
@@ -0,0 +1,14 @@
+#pragma once
+#include <stdbool.h>
+//
+// Whole-table fitting and evaluation of the sky tracks, for the sweep.  The
+// watch only evaluates single segments (sky_track_segment in
+// src/c/sky_track.c), with the slopes worked out from the stored samples by
+// sky_store.c the same way sky_track_fit() does here.
+//
+
+// fit slope[] to value[] (count samples, one hour apart)
+void sky_track_fit(const float value[], float slope[], int count, bool wrap360);
+
+// evaluate the track at hour (0..count-1, fractional)
+float sky_track_eval(const float value[], const float slope[], int count, float hour, bool wrap360);
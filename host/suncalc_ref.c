@@ -0,0 +1,59 @@
+#include <math.h>
+#include "suncalc_ref.h"
+//
+// Straight double precision port of suncalc.js
+// (c) 2011-2015, Vladimir Agafonkin, https://github.com/mourner/suncalc
+//
+
+#define RAD (M_PI / 180)
+#define OBLIQUITY (RAD * 23.4397)
+
+static double to_days(time_t unixdate) {
+  return (unixdate - 946684800.0) / 86400 - 0.5;
+}
+
+static double right_ascension(double l, double b) {
+  return atan2(sin(l) * cos(OBLIQUITY) - tan(b) * sin(OBLIQUITY), cos(l));
+}
+
+static double declination(double l, double b) {
+  return asin(sin(b) * cos(OBLIQUITY) + cos(b) * sin(OBLIQUITY) * sin(l));
+}
+
+static double azimuth(double H, double phi, double dec) {
+  return atan2(sin(H), cos(H) * sin(phi) - tan(dec) * cos(phi));
+}
+
+static double altitude(double H, double phi, double dec) {
+  return asin(sin(phi) * sin(dec) + cos(phi) * cos(dec) * cos(H));
+}
+
+static double sidereal_time(double d, double lw) {
+  return RAD * (280.16 + 360.9856235 * d) - lw;
+}
+
+void ref_sun_position(time_t unixdate, double lat, double lng, double *azi, double *alt) {
+  double d = to_days(unixdate);
+  double M = RAD * (357.5291 + 0.98560028 * d);
+  double C = RAD * (1.9148 * sin(M) + 0.02 * sin(2 * M) + 0.0003 * sin(3 * M));
+  double L = M + C + RAD * 102.9372 + M_PI;
+  double dec = declination(L, 0);
+  double ra = right_ascension(L, 0);
+  double H = sidereal_time(d, RAD * -lng) - ra;
+  *azi = azimuth(H, RAD * lat, dec);
+  *alt = altitude(H, RAD * lat, dec);
+}
+
+void ref_moon_position(time_t unixdate, double lat, double lng, double *azi, double *alt) {
+  double d = to_days(unixdate);
+  double L = RAD * (218.316 + 13.176396 * d);
+  double M = RAD * (134.963 + 13.064993 * d);
+  double F = RAD * (93.272 + 13.229350 * d);
+  double l = L + RAD * 6.289 * sin(M);
+  double b = RAD * 5.128 * sin(F);
+  double dec = declination(l, b);
+  double ra = right_ascension(l, b);
+  double H = sidereal_time(d, RAD * -lng) - ra;
+  *azi = azimuth(H, RAD * lat, dec);
+  *alt = altitude(H, RAD * lat, dec);
+}
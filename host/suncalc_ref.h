@@ -0,0 +1,9 @@
+#pragma once
+#include <time.h>
+//
+// Double precision suncalc, used as the golden reference on the host.
+// Same formulas as src/c/ephemeris.c but with a real arcsine and libm trig.
+// Angles in radians; azimuth measured like suncalc, from south towards west.
+//
+void ref_sun_position(time_t unixdate, double lat, double lng, double *azi, double *alt);
+void ref_moon_position(time_t unixdate, double lat, double lng, double *azi, double *alt);
@@ -0,0 +1,426 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "pebble.h"
+#include "ephemeris.h"
+#include "sky_events.h"
+#include "sky_track_fit.h"
+#include "suncalc_ref.h"
+//
+// Accuracy and throughput sweep against double precision suncalc
+//
+// Compares each trig kernel of ephemeris.c with libm, then the hourly
+// elevation/azimuth tables from both engines with suncalc_ref.c for every
+// latitude from -90 to 90 over every day of 2026.  Errors are reported as
+// max and RMS next to the time per call, and the tables are also checked
+// against a one pixel budget on the graph at the 64.8N default location.
+// Then positions between the hourly samples, as the watchface shows them
+// every minute, are compared for linear interpolation and the fitted splines.
+// Finally the rise, set and twilight times are checked against a minute by
+// minute scan at high latitudes, through polar day and polar night.
+//
+
+#define START_2026 1767225600  // 2026-01-01 00:00:00 UTC
+#define DEFAULT_LAT 64.8
+#define DEFAULT_LNG -147
+#define RAD (M_PI / 180)
+
+// graph geometry of a 144x168 watch, as set up in main_window_load
+#define GRAPH_WIDTH 144.0
+#define GRAPH_HEIGHT (168 * 0.4)
+#define PIXEL_BUDGET 1.0
+
+typedef struct {
+  double max;
+  double sum_sq;
+  long count;
+} ErrorStat;
+
+static volatile float s_sink;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void stat_add(ErrorStat *stat, double err) {
+  err = fabs(err);
+  if (err > stat->max) stat->max = err;
+  stat->sum_sq += err * err;
+  stat->count++;
+}
+
+static double stat_rms(const ErrorStat *stat) {
+  return stat->count ? sqrt(stat->sum_sq / stat->count) : 0;
+}
+
+static void stat_print(const char *name, const ErrorStat *stat, const char *unit, double ns_per_call) {
+  printf("  %-28s max %9.4f  rms %9.4f %-4s %8.1f ns/call\n", name, stat->max, stat_rms(stat), unit, ns_per_call);
+}
+
+static double wrap_degrees(double d) {
+  d = fmod(d, 360);
+  if (d > 180) d -= 360;
+  if (d < -180) d += 360;
+  return d;
+}
+
+//
+// trig kernels
+//
+
+#define KERNEL_SAMPLES 200001
+
+static void sweep_kernels(void) {
+  ErrorStat sin_err = {0}, cos_err = {0}, asin_err = {0}, asin_small_err = {0}, atan2_err = {0};
+  double t, sin_ns, cos_ns, asin_ns, atan2_ns;
+  int i, j;
+
+  for (i = 0; i < KERNEL_SAMPLES; i++) {
+    float x = -4 * M_PI + 8 * M_PI * i / (KERNEL_SAMPLES - 1);
+    stat_add(&sin_err, sin_pebble(x) - sin(x));
+    stat_add(&cos_err, cos_pebble(x) - cos(x));
+  }
+  for (i = 0; i < KERNEL_SAMPLES; i++) {
+    float x = -1 + 2.0 * i / (KERNEL_SAMPLES - 1);
+    double err = (asin_pebble(x) - asin(x)) / RAD;
+    stat_add(&asin_err, err);
+    if (fabs(x) <= 0.5) stat_add(&asin_small_err, err);
+  }
+  for (i = -200; i <= 200; i++) {
+    for (j = -200; j <= 200; j++) {
+      float y = i / 100.0, x = j / 100.0;
+      if (i == 0 && j == 0) continue;
+      stat_add(&atan2_err, wrap_degrees((atan2_pebble(y, x) - atan2(y, x)) / RAD));
+    }
+  }
+
+  t = now_ns();
+  for (i = 0; i < KERNEL_SAMPLES; i++) s_sink = sin_pebble(-4 * M_PI + 8 * M_PI * i / (KERNEL_SAMPLES - 1));
+  sin_ns = (now_ns() - t) / KERNEL_SAMPLES;
+  t = now_ns();
+  for (i = 0; i < KERNEL_SAMPLES; i++) s_sink = cos_pebble(-4 * M_PI + 8 * M_PI * i / (KERNEL_SAMPLES - 1));
+  cos_ns = (now_ns() - t) / KERNEL_SAMPLES;
+  t = now_ns();
+  for (i = 0; i < KERNEL_SAMPLES; i++) s_sink = asin_pebble(-1 + 2.0 * i / (KERNEL_SAMPLES - 1));
+  asin_ns = (now_ns() - t) / KERNEL_SAMPLES;
+  t = now_ns();
+  for (i = -200; i <= 200; i++) {
+    for (j = -200; j <= 200; j++) s_sink = atan2_pebble(i / 100.0, j / 100.0);
+  }
+  atan2_ns = (now_ns() - t) / (401 * 401);
+
+  printf("Trig kernels against libm\n");
+  stat_print("sin_pebble (ratio)", &sin_err, "", sin_ns);
+  stat_print("cos_pebble (ratio)", &cos_err, "", cos_ns);
+  stat_print("asin_pebble |x|<=1", &asin_err, "deg", asin_ns);
+  stat_print("asin_pebble |x|<=0.5", &asin_small_err, "deg", asin_ns);
+  stat_print("atan2_pebble |x|,|y|<=2", &atan2_err, "deg", atan2_ns);
+}
+
+//
+// tables
+//
+
+typedef void (*TableBuilder)(time_t, int, int, float, float, float[], float[], float[], float[]);
+
+typedef struct {
+  ErrorStat solar_elev, solar_azi, lunar_elev, lunar_azi;
+  ErrorStat elev_px, azi_px;  // at the default location
+  double build_ns;
+  long tables;
+} TableSweep;
+
+static void compare_tables(TableSweep *sweep, TableBuilder build, time_t day, float lat, float lng, bool pixels) {
+  float solar_elev[25], solar_azi[25], lunar_elev[25], lunar_azi[25];
+  double azi, alt;
+  int i;
+
+  double t = now_ns();
+  build(day, 0, 24, lat, lng, solar_elev, solar_azi, lunar_elev, lunar_azi);
+  sweep->build_ns += now_ns() - t;
+  sweep->tables++;
+
+  // y pixels per degree of elevation and x pixels per degree of azimuth
+  double range = (90 - lat + 23.5) * 1.35;
+  if (range > 110) range = 110;
+  double y_scale = GRAPH_HEIGHT / (int)range;
+  double x_scale = GRAPH_WIDTH / 360;
+
+  for (i = 0; i < 25; i++) {
+    time_t when = day + i * 3600;
+    ref_sun_position(when, lat, lng, &azi, &alt);
+    stat_add(&sweep->solar_elev, solar_elev[i] - alt / RAD);
+    // azimuth is undefined at the poles and ill-conditioned near the zenith
+    bool azi_defined = fabs(lat) < 90 && fabs(alt / RAD) < 80;
+    double azi_err = wrap_degrees(solar_azi[i] - (azi / RAD + 180));
+    if (azi_defined) stat_add(&sweep->solar_azi, azi_err);
+    if (pixels && alt / RAD > -7) {
+      stat_add(&sweep->elev_px, (solar_elev[i] - alt / RAD) * y_scale);
+    }
+
+    ref_moon_position(when, lat, lng, &azi, &alt);
+    stat_add(&sweep->lunar_elev, lunar_elev[i] - alt / RAD);
+    azi_defined = fabs(lat) < 90 && fabs(alt / RAD) < 80;
+    azi_err = wrap_degrees(lunar_azi[i] - (azi / RAD + 180));
+    if (azi_defined) stat_add(&sweep->lunar_azi, azi_err);
+    if (pixels && alt / RAD > -7) {
+      stat_add(&sweep->elev_px, (lunar_elev[i] - alt / RAD) * y_scale);
+      if (azi_defined) stat_add(&sweep->azi_px, azi_err * x_scale);
+    }
+  }
+}
+
+static void sweep_tables(const char *engine, TableBuilder build) {
+  TableSweep sweep = {0};
+  TableSweep local = {0};
+  int lat, day;
+
+  for (lat = -90; lat <= 90; lat++) {
+    for (day = 0; day < 365; day++) {
+      compare_tables(&sweep, build, START_2026 + day * 86400, lat, DEFAULT_LNG, false);
+    }
+  }
+  for (day = 0; day < 365; day++) {
+    compare_tables(&local, build, START_2026 + day * 86400, DEFAULT_LAT, DEFAULT_LNG, true);
+  }
+
+  double ns_per_sample = sweep.build_ns / sweep.tables / 25;
+  printf("%s engine tables, latitudes -90..90, every day of 2026 (%ld tables)\n", engine, sweep.tables);
+  stat_print("solar_elev", &sweep.solar_elev, "deg", ns_per_sample);
+  stat_print("solar_azi (alt < 80)", &sweep.solar_azi, "deg", ns_per_sample);
+  stat_print("lunar_elev", &sweep.lunar_elev, "deg", ns_per_sample);
+  stat_print("lunar_azi (alt < 80)", &sweep.lunar_azi, "deg", ns_per_sample);
+  printf("  at %.1fN: max %.2f px elevation, %.2f px azimuth on the graph -> %s the %.0f px budget\n",
+         DEFAULT_LAT, local.elev_px.max, local.azi_px.max,
+         (local.elev_px.max <= PIXEL_BUDGET && local.azi_px.max <= PIXEL_BUDGET) ? "within" : "OVER", PIXEL_BUDGET);
+}
+
+//
+// positions between the hourly samples
+//
+
+static float interpolate_linear(const float value[], float hour, bool azimuth) {
+  int i = (int)hour;
+  float frac = hour - i;
+  if (azimuth) return fmod_pebble(value[i] + 15 * frac, 360);  // as the face used to
+  return value[i] + frac * (value[i+1] - value[i]);
+}
+
+static void sweep_interpolation(void) {
+  ErrorStat linear[4] = {{0}}, spline[4] = {{0}};
+  float tables[4][25], slopes[4][25];
+  float azi, alt;
+  int day, minute, k;
+  static const char *names[4] = {"solar_elev", "solar_azi", "lunar_elev", "lunar_azi"};
+
+  for (day = 0; day < 365; day++) {
+    time_t start = START_2026 + day * 86400;
+    sky_paths_hours(start, 0, 24, DEFAULT_LAT, DEFAULT_LNG, tables[0], tables[1], tables[2], tables[3]);
+    for (k = 0; k < 4; k++) sky_track_fit(tables[k], slopes[k], 25, k & 1);
+
+    for (minute = 0; minute < 24 * 60; minute += 10) {
+      float hour = minute / 60.0f;
+      // the engine itself at this minute, so only the interpolation is measured
+      float exact[4];
+      sunPosition(start + minute * 60, DEFAULT_LAT, DEFAULT_LNG, &azi, &alt);
+      exact[0] = alt * deg_conv;
+      exact[1] = azi * deg_conv + 180;
+      moonPosition(start + minute * 60, DEFAULT_LAT, DEFAULT_LNG, &azi, &alt);
+      exact[2] = alt * deg_conv;
+      exact[3] = azi * deg_conv + 180;
+      for (k = 0; k < 4; k++) {
+        float a = interpolate_linear(tables[k], hour, k & 1);
+        float b = sky_track_eval(tables[k], slopes[k], 25, hour, k & 1);
+        if (k & 1) {
+          stat_add(&linear[k], wrap_degrees(a - exact[k]));
+          stat_add(&spline[k], wrap_degrees(b - exact[k]));
+        }
+        else {
+          stat_add(&linear[k], a - exact[k]);
+          stat_add(&spline[k], b - exact[k]);
+        }
+      }
+    }
+  }
+
+  // cost per evaluation, over every minute of one day
+  double t = now_ns();
+  for (k = 0; k < 4; k++) {
+    for (minute = 0; minute < 24 * 60; minute++) s_sink = interpolate_linear(tables[k], minute / 60.0f, k & 1);
+  }
+  double linear_ns = (now_ns() - t) / (4 * 24 * 60);
+  t = now_ns();
+  for (k = 0; k < 4; k++) {
+    for (minute = 0; minute < 24 * 60; minute++) s_sink = sky_track_eval(tables[k], slopes[k], 25, minute / 60.0f, k & 1);
+  }
+  double spline_ns = (now_ns() - t) / (4 * 24 * 60);
+
+  printf("Positions every 10 minutes at %.1fN through 2026, against the engine at that minute\n", DEFAULT_LAT);
+  for (k = 0; k < 4; k++) {
+    char name[40];
+    snprintf(name, sizeof(name), "%s linear", names[k]);
+    stat_print(name, &linear[k], "deg", linear_ns);
+    snprintf(name, sizeof(name), "%s spline", names[k]);
+    stat_print(name, &spline[k], "deg", spline_ns);
+  }
+}
+
+//
+// rise, set and twilight times
+//
+
+// The engine works in a float day number, which in 2026 only resolves 2^-10
+// of a day, so its elevations move in steps that long: a tenth of a degree
+// or more for a body near the horizon.  The solver and the scan each place a
+// crossing within a step, and the event text shows minutes.
+#define EVENT_STEP_SECS 84
+#define EVENT_BUDGET_SECS (60 + EVENT_STEP_SECS)
+#define EVENT_NOISE_DEG 0.05   // elevations this close to the horizon are grazes
+#define SCAN_MINUTES (24 * 60)
+
+// the default location, the arctic circle where the sun grazes the horizon,
+// Tromso (polar night, with civil twilight at noon), Svalbard (civil polar
+// night too) and the antarctic coast
+static const double s_event_lats[] = {DEFAULT_LAT, 66.6, 69.6, 78.2, -69.0};
+
+typedef struct {
+  ErrorStat secs;      // solved against scanned, where both find the crossing in time
+  int crossings;
+  int flat;            // out of the budget, but so near the horizon the time can't be told
+  int off;             // solved crossings out of the budget, or missed
+  int grazes;          // days the body only comes within the noise of the horizon
+  int up, down;        // days up or down all day, as scanned
+} EventSweep;
+
+typedef struct {
+  time_t rise, set;
+  bool graze;          // within the noise of the horizon, without crossing it
+  bool up;             // which side of the horizon it starts the day
+} ScannedCrossings;
+
+// the first crossing of horizon each way in elevations a minute apart.  A
+// crossing only counts once the body is clear of the horizon by the noise,
+// and is put where the last minute on the way changed sign, interpolated
+// within it
+static void scan_crossings(const float elev[], time_t day_start, float horizon, ScannedCrossings *scanned) {
+  int m;
+  int side = 0;            // -1 below, 1 above, 0 not clear of the noise yet
+  time_t last_change = 0;
+  scanned->rise = 0;
+  scanned->set = 0;
+  scanned->graze = false;
+  scanned->up = false;
+  for (m = 0; m <= SCAN_MINUTES; m++) {
+    float a = elev[m] - horizon;
+    if ((m > 0) && ((elev[m-1] - horizon < 0) != (a < 0))) {
+      float a0 = elev[m-1] - horizon;
+      last_change = day_start + (m - 1) * 60 + (time_t)(60 * a0 / (a0 - a));
+    }
+    if (fabs(a) <= EVENT_NOISE_DEG) {
+      scanned->graze = true;
+      continue;
+    }
+    int now = (a < 0) ? -1 : 1;
+    if (side == 0) scanned->up = (now > 0);
+    else if (now != side) {
+      if ((now > 0) && !scanned->rise) scanned->rise = last_change;
+      if ((now < 0) && !scanned->set) scanned->set = last_change;
+    }
+    side = now;
+  }
+  if (scanned->rise || scanned->set) scanned->graze = false;
+}
+
+// elevation above horizon from the engine, as the solver sees it
+static double elev_above(bool moon, time_t when, double lat, float horizon) {
+  float azi, alt;
+  if (moon) moonPosition(when, lat, DEFAULT_LNG, &azi, &alt);
+  else sunPosition(when, lat, DEFAULT_LNG, &azi, &alt);
+  return alt * deg_conv - horizon;
+}
+
+// a solved crossing is right within the budget of the scanned one, or where
+// the body is within the noise of the horizon and the time can't be told
+static void compare_crossing(EventSweep *sweep, bool moon, double lat, float horizon, time_t solved, time_t scanned) {
+  if (!solved && !scanned) return;
+  sweep->crossings++;
+  bool timed = solved && scanned && (labs((long)(solved - scanned)) <= EVENT_BUDGET_SECS);
+  if (timed) stat_add(&sweep->secs, (double)(solved - scanned));
+  else if (solved && (fabs(elev_above(moon, solved, lat, horizon)) <= EVENT_NOISE_DEG)) sweep->flat++;
+  else sweep->off++;
+}
+
+static void compare_crossings(EventSweep *sweep, const SkyCrossings *solved, bool moon, double lat,
+                              const float elev[], time_t day_start, float horizon) {
+  ScannedCrossings scanned;
+  scan_crossings(elev, day_start, horizon, &scanned);
+  compare_crossing(sweep, moon, lat, horizon, solved->rise, scanned.rise);
+  compare_crossing(sweep, moon, lat, horizon, solved->set, scanned.set);
+  if (scanned.graze) sweep->grazes++;
+  if (scanned.rise || scanned.set || scanned.graze) return;
+
+  // all day on one side, clear of the noise
+  SkyAllDay all_day = scanned.up ? SKY_UP_ALL_DAY : SKY_DOWN_ALL_DAY;
+  if (solved->all_day != all_day) sweep->off++;
+  if (all_day == SKY_UP_ALL_DAY) sweep->up++;
+  else sweep->down++;
+}
+
+static void event_print(const char *name, const EventSweep *sweep, double ns_per_solve) {
+  stat_print(name, &sweep->secs, "s", ns_per_solve);
+  printf("    %d crossings (%d too flat to time), %d grazes, %d days up and %d down all day: %d off -> %s the %d s budget\n",
+         sweep->crossings, sweep->flat, sweep->grazes, sweep->up, sweep->down, sweep->off,
+         sweep->off ? "OVER" : "within", EVENT_BUDGET_SECS);
+}
+
+static void sweep_events(void) {
+  EventSweep sun = {{0}}, civil = {{0}}, moon = {{0}};
+  float solar_elev[25], solar_azi[25], lunar_elev[25], lunar_azi[25];
+  static float solar_scan[SCAN_MINUTES + 1], lunar_scan[SCAN_MINUTES + 1];
+  float azi, alt;
+  SkyEvents events;
+  double solve_ns = 0;
+  long solves = 0;
+  int l, day, m;
+  int lats = sizeof(s_event_lats) / sizeof(s_event_lats[0]);
+
+  for (l = 0; l < lats; l++) {
+    double lat = s_event_lats[l];
+    for (day = 0; day < 365; day++) {
+      time_t start = START_2026 + day * 86400;
+      sky_paths_hours(start, 0, 24, lat, DEFAULT_LNG, solar_elev, solar_azi, lunar_elev, lunar_azi);
+      double t = now_ns();
+      sky_events_solve(&events, start, lat, DEFAULT_LNG, solar_elev, lunar_elev);
+      solve_ns += now_ns() - t;
+      solves++;
+
+      for (m = 0; m <= SCAN_MINUTES; m++) {
+        sunPosition(start + m * 60, lat, DEFAULT_LNG, &azi, &alt);
+        solar_scan[m] = alt * deg_conv;
+        moonPosition(start + m * 60, lat, DEFAULT_LNG, &azi, &alt);
+        lunar_scan[m] = alt * deg_conv;
+      }
+      compare_crossings(&sun, &events.sun, false, lat, solar_scan, start, SKY_SUN_HORIZON);
+      compare_crossings(&civil, &events.civil, false, lat, solar_scan, start, SKY_CIVIL_TWILIGHT);
+      compare_crossings(&moon, &events.moon, true, lat, lunar_scan, start, SKY_MOON_HORIZON);
+    }
+  }
+
+  printf("Rise and set times at");
+  for (l = 0; l < lats; l++) printf(" %.1f%c", fabs(s_event_lats[l]), (s_event_lats[l] < 0) ? 'S' : 'N');
+  printf(" through 2026, against a minute by minute scan\n");
+  event_print("sunrise and sunset", &sun, solve_ns / solves);
+  event_print("dawn and dusk", &civil, solve_ns / solves);
+  event_print("moonrise and moonset", &moon, solve_ns / solves);
+}
+
+int main(void) {
+  sweep_kernels();
+  sweep_tables("float", sky_paths_hours);
+  sweep_tables("fixed", sky_paths_hours_fixed);
+  sweep_interpolation();
+  sweep_events();
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include "bitmap_cache.h"
+
+typedef struct BitmapCacheSlot {
+  uint32_t resource_id;
+  GBitmap *bitmap;
+  int refs;     // 0 for a free slot
+  int bytes;    // heap taken by loading it
+} BitmapCacheSlot;
+
+static BitmapCacheSlot s_slots[BITMAP_CACHE_SLOTS];
+static int s_live_bytes;
+static int s_peak_bytes;
+
+static BitmapCacheSlot *find_resource(uint32_t resource_id) {
+  int i;
+  for (i=0;i<BITMAP_CACHE_SLOTS;i++) {
+    if ((s_slots[i].refs > 0) && (s_slots[i].resource_id == resource_id)) return &s_slots[i];
+  }
+  return NULL;
+}
+
+static BitmapCacheSlot *find_bitmap(GBitmap *bitmap) {
+  int i;
+  for (i=0;i<BITMAP_CACHE_SLOTS;i++) {
+    if ((s_slots[i].refs > 0) && (s_slots[i].bitmap == bitmap)) return &s_slots[i];
+  }
+  return NULL;
+}
+
+GBitmap *bitmap_cache_acquire(uint32_t resource_id) {
+  BitmapCacheSlot *slot = find_resource(resource_id);
+  if (slot) {
+    slot->refs++;
+    return slot->bitmap;
+  }
+
+  for (slot=&s_slots[0];(slot<&s_slots[BITMAP_CACHE_SLOTS])&&(slot->refs>0);slot++);
+  if (slot == &s_slots[BITMAP_CACHE_SLOTS]) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Bitmap cache full, can't load resource %d", (int)resource_id);
+    return NULL;
+  }
+
+  int heap_before = heap_bytes_used();
+  slot->bitmap = gbitmap_create_with_resource(resource_id);
+  if (!slot->bitmap) return NULL;
+  slot->resource_id = resource_id;
+  slot->refs = 1;
+  slot->bytes = heap_bytes_used() - heap_before;
+
+  s_live_bytes += slot->bytes;
+  if (s_live_bytes > s_peak_bytes) s_peak_bytes = s_live_bytes;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Bitmap cache loaded resource %d, %d bytes; %d live, %d peak",
+          (int)resource_id, slot->bytes, s_live_bytes, s_peak_bytes);
+  return slot->bitmap;
+}
+
+void bitmap_cache_release(GBitmap *bitmap) {
+  BitmapCacheSlot *slot;
+  if (!bitmap) return;
+  slot = find_bitmap(bitmap);
+  if (!slot) return;
+
+  if (--slot->refs == 0) {
+    gbitmap_destroy(slot->bitmap);
+    slot->bitmap = NULL;
+    s_live_bytes -= slot->bytes;
+  }
+}
+
+GBitmap *bitmap_cache_switch(GBitmap *bitmap, uint32_t resource_id) {
+  // take the new one before letting the old go, so the same image is kept;
+  // if it can't be loaded, keep showing the old one
+  GBitmap *result = bitmap_cache_acquire(resource_id);
+  if (!result) return bitmap;
+  bitmap_cache_release(bitmap);
+  return result;
+}
+
+int bitmap_cache_bytes(GBitmap *bitmap) {
+  BitmapCacheSlot *slot = bitmap ? find_bitmap(bitmap) : NULL;
+  return slot ? slot->bytes : 0;
+}
+
+int bitmap_cache_live_bytes() {
+  return s_live_bytes;
+}
+
+int bitmap_cache_peak_bytes() {
+  return s_peak_bytes;
+}
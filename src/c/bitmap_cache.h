@@ -0,0 +1,30 @@
+#pragma once
+#include <pebble.h>
+//
+// Reference-counted cache of bitmap resources
+//
+// Each resource is loaded once and handed out as a shared GBitmap; it is
+// only destroyed when the last holder releases it.  Switching a handle to
+// the image it already shows costs nothing, so the hourly image refresh no
+// longer creates (and leaks) a new bitmap every time.
+//
+// The heap each bitmap takes is measured with heap_bytes_used() as it is
+// loaded, giving the live and peak bytes held by the cache.
+//
+
+#define BITMAP_CACHE_SLOTS 6   // more than the face ever holds at once
+
+// a shared bitmap for the resource, NULL if it can't be loaded
+GBitmap *bitmap_cache_acquire(uint32_t resource_id);
+
+// give up a bitmap from bitmap_cache_acquire (NULL is fine)
+void bitmap_cache_release(GBitmap *bitmap);
+
+// swap a held bitmap for the resource's, reloading only if it is a different one
+GBitmap *bitmap_cache_switch(GBitmap *bitmap, uint32_t resource_id);
+
+// heap taken by one bitmap from the cache
+int bitmap_cache_bytes(GBitmap *bitmap);
+
+int bitmap_cache_live_bytes();
+int bitmap_cache_peak_bytes();
@@ -0,0 +1,528 @@
+#include "ephemeris.h"
+#include "ephemeris_tables.h"
+//
+// Adapted from the javascript code below to C
+//
+// https://github.com/mourner/suncalc/blob/master/suncalc.js
+//
+//
+// (c) 2011-2015, Vladimir Agafonkin
+// SunCalc is a JavaScript library for calculating sun/moon position and light phases.
+// https://github.com/mourner/suncalc
+//
+// sun calculations are based on http://aa.quae.nl/en/reken/zonpositie.html formulas
+
+// date/time constants and conversions
+
+float pi = 3.14159268;
+float rad = 3.14159268 / 180;
+float daySecs = 60 * 60 * 24;
+time_t J2000 = 946684800; // year 2000 in unix time
+float deg_conv = 180 / 3.14159268;
+
+float sin_pebble(float angle_radians) {
+  int32_t angle_pebble = angle_radians * TRIG_MAX_ANGLE / (2*pi);
+  return ((float)(sin_lookup(angle_pebble)) / (float)TRIG_MAX_RATIO);
+}
+
+// table units to radians
+#define TABLE_RADIANS (3.14159268f / 2 / TABLE_QUARTER_TURN)
+
+float asin_pebble(float sine) {
+  float a = (sine < 0) ? -sine : sine;
+  int32_t angle;
+  if (a >= 1) angle = TABLE_QUARTER_TURN;
+  else if (a < 1 - 1.0f / ASIN_TAIL_FRACTION) {
+    angle = table_interpolate(ephemeris_asin_table, ASIN_TABLE_STEPS, (int32_t)(a * (ASIN_TABLE_STEPS * 256)));
+  }
+  else {
+    angle = table_interpolate(ephemeris_asin_tail_table, ASIN_TAIL_STEPS,
+                              (int32_t)((a * ASIN_TAIL_FRACTION - (ASIN_TAIL_FRACTION - 1)) * (ASIN_TAIL_STEPS * 256)));
+  }
+  return (sine < 0) ? -angle * TABLE_RADIANS : angle * TABLE_RADIANS;
+}
+
+float cos_pebble(float angle_radians) {
+  int32_t angle_pebble = angle_radians * TRIG_MAX_ANGLE / (2*pi);
+  return ((float)cos_lookup(angle_pebble) / (float)TRIG_MAX_RATIO);
+}
+
+// 0..2pi, as atan2_lookup gives it, for any size of y and x
+float atan2_pebble(float y, float x) {
+  float ay = (y < 0) ? -y : y;
+  float ax = (x < 0) ? -x : x;
+  int32_t angle;
+  if (ay == 0 && ax == 0) return 0;
+  // the first octant from the table, then folded out to the quadrant
+  if (ay <= ax) angle = table_interpolate(ephemeris_atan_table, ATAN_TABLE_STEPS, (int32_t)(ay / ax * (ATAN_TABLE_STEPS * 256)));
+  else angle = TABLE_QUARTER_TURN - table_interpolate(ephemeris_atan_table, ATAN_TABLE_STEPS, (int32_t)(ax / ay * (ATAN_TABLE_STEPS * 256)));
+  if (x < 0) angle = 2 * TABLE_QUARTER_TURN - angle;
+  if ((y < 0) && (angle > 0)) angle = 4 * TABLE_QUARTER_TURN - angle;
+  return angle * TABLE_RADIANS;
+}
+
+float fmod_pebble(float product, float divisor) {
+  int32_t factor;
+  float remainder;
+  
+  factor = (int32_t)(product/divisor);
+  if (product<0) factor--;    // casting to int truncates so check if negative and decrement
+  remainder = product - ((float)factor)*divisor;
+  return remainder;
+}
+
+float toDays(time_t unixdate) {
+  return ((float)(unixdate-J2000) / daySecs -0.5);
+}
+
+// general calculations for position
+
+float e = 3.14159268 / 180 * 23.4397; // obliquity of the Earth
+
+float rightAscension(float l, float b) {
+  return atan2_pebble(sin_pebble(l) * cos_pebble(e) - sin_pebble(b)/cos_pebble(b) * sin_pebble(e), cos_pebble(l));
+}
+
+float declination(float l, float b) { 
+  return (asin_pebble(sin_pebble(b) * cos_pebble(e) + cos_pebble(b) * sin_pebble(e) * sin_pebble(l)));
+}
+
+float azimuth(float H, float phi, float dec) {
+  return (atan2_pebble(sin_pebble(H), cos_pebble(H) * sin_pebble(phi) - sin_pebble(dec)/cos_pebble(dec) * cos_pebble(phi)));
+}
+
+float altitude(float H, float phi, float dec) { 
+  return (asin_pebble(sin_pebble(phi) * sin_pebble(dec) + cos_pebble(phi) * cos_pebble(dec) * cos_pebble(H))); 
+}
+
+float siderealTime(float d, float lw) { 
+  return (rad * (280.16 + 360.9856235 * d) - lw);
+}
+
+// general sun calculations
+
+float solarMeanAnomaly(float d) { 
+  return (rad * (357.5291 + 0.98560028 * d)); 
+}
+
+// the sun's equation of centre in degrees, for mean anomaly M, from its table
+static float equation_of_centre(float M) {
+  int32_t angle = (int32_t)(M * TRIG_MAX_ANGLE / (2*pi)) & (TRIG_MAX_ANGLE - 1);
+  return (float)table_interpolate_signed(ephemeris_centre_table, CENTRE_TABLE_STEPS, angle * CENTRE_TABLE_STEPS / (TRIG_MAX_ANGLE / 256)) /
+         CENTRE_TABLE_SCALE;
+}
+
+float eclipticLongitude(float M) {
+  float C = rad * equation_of_centre(M); // equation of center
+  float P = rad * 102.9372; // perihelion of the Earth
+  return (M + C + P + pi);
+}
+
+void sunCoords(float d, float *dec, float *ra) {
+
+  float M = solarMeanAnomaly(d);
+  float L = eclipticLongitude(M);
+
+  *dec = declination(L, 0);
+  *ra = rightAscension(L, 0);
+}
+
+void sunPosition(time_t unixdate, float lat, float lng, float *azi, float *alt) {
+// calculates sun position for a given date and latitude/longitude
+
+  float lw  = rad * -lng;
+  float phi = rad * lat;
+  float d = toDays(unixdate);
+
+  float dec, ra;
+  sunCoords(d, &dec, &ra);
+  float H  = siderealTime(d, lw) - ra;
+
+  *azi = azimuth(H, phi, dec);
+  *alt = altitude(H, phi, dec);
+};
+
+// moon calculations, based on http://aa.quae.nl/en/reken/hemelpositie.html formulas
+
+void moonCoords(float d, float *ra, float *dec) { 
+// geocentric ecliptic coordinates of the moon
+
+  float L = rad * (218.316 + 13.176396 * d); // ecliptic longitude
+  float M = rad * (134.963 + 13.064993 * d); // mean anomaly
+  float F = rad * (93.272 + 13.229350 * d);  // mean distance
+
+  float l  = L + rad * 6.289 * sin_pebble(M); // longitude
+  float b  = rad * 5.128 * sin_pebble(F);     // latitude
+
+  *ra = rightAscension(l, b);
+  *dec = declination(l, b);
+}
+
+void moonPosition(time_t unixdate, float lat, float lng, float *azi, float *alt) {
+  float lw  = rad * -lng;
+  float phi = rad * lat;
+  float d = toDays(unixdate);
+
+  float ra, dec;
+  moonCoords(d, &ra, &dec);
+  float H = siderealTime(d, lw) - ra;
+  float h = altitude(H, phi, dec);
+// formula 14.1 of "Astronomical Algorithms" 2nd edition by Jean Meeus (Willmann-Bell, Richmond) 1998.
+
+  *azi = azimuth(H, phi, dec);
+  *alt = h;
+};
+
+// Observer context for building tables
+//
+// Building a table calls the above 25 times per body, and each call works
+// out the same latitude and obliquity terms again, plus a fresh sidereal
+// angle even though it only advances by a fixed step per sample.  The
+// observer keeps those invariants, and advances the sidereal angle with an
+// angle-addition rotation, re-synchronising it from siderealTime every
+// SKY_OBSERVER_RESYNC steps so rounding can't build up.  The hour angle is
+// then formed from the sidereal angle and the right ascension's (sin, cos)
+// pair, without an atan2 or any further lookups.
+
+#define SKY_OBSERVER_RESYNC 6
+
+// 1/sqrt(x) for x near 1 (between about 0.7 and 1.3), by Newton iteration
+static float inv_sqrt_near_one(float x) {
+  float y = 1;
+  y = y * (1.5f - 0.5f * x * y * y);
+  y = y * (1.5f - 0.5f * x * y * y);
+  y = y * (1.5f - 0.5f * x * y * y);
+  return y;
+}
+
+static void sky_observer_sync(SkyObserver *obs) {
+  float theta = siderealTime(toDays(obs->time), obs->lw);
+  obs->sin_theta = sin_pebble(theta);
+  obs->cos_theta = cos_pebble(theta);
+  obs->steps_since_sync = 0;
+}
+
+void sky_observer_init(SkyObserver *obs, float lat, float lng, time_t start, int step_secs) {
+  float phi = rad * lat;
+  float step = rad * 360.9856235 * step_secs / daySecs;
+
+  obs->sin_phi = sin_pebble(phi);
+  obs->cos_phi = cos_pebble(phi);
+  obs->sin_e = sin_pebble(e);
+  obs->cos_e = cos_pebble(e);
+  obs->lw = rad * -lng;
+  obs->sin_step = sin_pebble(step);
+  obs->cos_step = cos_pebble(step);
+  obs->step_secs = step_secs;
+  obs->time = start;
+  sky_observer_sync(obs);
+}
+
+void sky_observer_advance(SkyObserver *obs) {
+  obs->time += obs->step_secs;
+  if (++obs->steps_since_sync >= SKY_OBSERVER_RESYNC) {
+    sky_observer_sync(obs);
+  }
+  else {
+    // rotate the sidereal angle by one step
+    float sin_theta = obs->sin_theta * obs->cos_step + obs->cos_theta * obs->sin_step;
+    obs->cos_theta = obs->cos_theta * obs->cos_step - obs->sin_theta * obs->sin_step;
+    obs->sin_theta = sin_theta;
+  }
+}
+
+// azimuth and altitude for right ascension atan2(ra_y, ra_x) and declination
+static void observer_horizontal(const SkyObserver *obs, float ra_y, float ra_x, float dec, float *azi, float *alt) {
+  float inv_r = inv_sqrt_near_one(ra_y * ra_y + ra_x * ra_x);
+  float sin_ra = ra_y * inv_r;
+  float cos_ra = ra_x * inv_r;
+  // H = theta - ra
+  float sin_H = obs->sin_theta * cos_ra - obs->cos_theta * sin_ra;
+  float cos_H = obs->cos_theta * cos_ra + obs->sin_theta * sin_ra;
+  float sin_dec = sin_pebble(dec);
+  float cos_dec = cos_pebble(dec);
+
+  *azi = atan2_pebble(sin_H, cos_H * obs->sin_phi - sin_dec / cos_dec * obs->cos_phi);
+  *alt = asin_pebble(obs->sin_phi * sin_dec + obs->cos_phi * cos_dec * cos_H);
+}
+
+// the common stage every body goes through: its geocentric ecliptic
+// longitude l and latitude b, as sines and cosines, to the observer's sky
+static void observer_ecliptic(const SkyObserver *obs, float sin_l, float cos_l, float sin_b, float cos_b, float *azi, float *alt) {
+  observer_horizontal(obs, sin_l * obs->cos_e - sin_b / cos_b * obs->sin_e, cos_l,
+                      asin_pebble(sin_b * obs->cos_e + cos_b * obs->sin_e * sin_l), azi, alt);
+}
+
+//
+// Batched bodies
+//
+// All bodies at one sample share the day number, the observer terms and the
+// sidereal angle.  The sun's ecliptic longitude is worked out once too: the
+// sun is drawn from it, and it places the earth for the planets.
+//
+// The planets use the low precision Keplerian elements of Standish, "Keplerian
+// Elements for Approximate Positions of the Major Planets" (JPL), good to a
+// fraction of a degree over 1800-2050.  Only the mean longitude is moved on
+// with time: the orbits themselves turn by well under a degree a century, so
+// each one's orientation is worked out once, on first use.  Kepler's
+// equation is solved with one Newton step from a second order start, which
+// is plenty for these eccentricities.
+
+typedef struct SunTerms {
+  float cos_M;           // solar mean anomaly
+  float sin_L, cos_L;    // geocentric ecliptic longitude
+  float distance;        // AU
+} SunTerms;
+
+#ifndef SKYPATH_WORKER
+typedef struct PlanetElements {
+  float a;               // semi-major axis, AU
+  float e;               // eccentricity
+  float i;               // inclination, degrees
+  float L, L_rate;       // mean longitude, degrees and degrees per day from J2000
+  float peri;            // longitude of perihelion, degrees
+  float node;            // longitude of the ascending node, degrees
+} PlanetElements;
+
+static const PlanetElements s_planets[] = {
+  { 0.72333566, 0.00677672, 3.39467605, 181.97909950, 1.60213034, 131.60246718, 76.67984255 },  // Venus
+  { 1.52371034, 0.09339410, 1.84969142, -4.55343205, 0.52402068, -23.94362959, 49.55953891 },   // Mars
+  { 5.20288700, 0.04838624, 1.30439695, 34.39644051, 0.08308529, 14.72847983, 100.47390909 },   // Jupiter
+};
+
+#define PLANET_COUNT (SKY_BODY_COUNT - SKY_BODY_VENUS)
+
+// each orbit's axes in the ecliptic: P towards perihelion, Q 90 degrees on
+// in the direction of motion, scaled by the semi-major and semi-minor axes
+typedef struct PlanetOrbit {
+  float px, py, pz;
+  float qx, qy, qz;
+} PlanetOrbit;
+
+static PlanetOrbit s_orbits[PLANET_COUNT];
+static bool s_orbits_ready;
+
+static float inv_sqrt(float x);
+
+static void init_orbits() {
+  int k;
+  for (k=0;k<PLANET_COUNT;k++) {
+    const PlanetElements *planet = &s_planets[k];
+    PlanetOrbit *orbit = &s_orbits[k];
+    float omega = rad * (planet->peri - planet->node);   // argument of perihelion
+    float sin_w = sin_pebble(omega), cos_w = cos_pebble(omega);
+    float sin_n = sin_pebble(rad * planet->node), cos_n = cos_pebble(rad * planet->node);
+    float sin_i = sin_pebble(rad * planet->i), cos_i = cos_pebble(rad * planet->i);
+    float b = planet->a * (1 - planet->e * planet->e) * inv_sqrt(1 - planet->e * planet->e);
+    orbit->px = planet->a * (cos_w * cos_n - sin_w * sin_n * cos_i);
+    orbit->py = planet->a * (cos_w * sin_n + sin_w * cos_n * cos_i);
+    orbit->pz = planet->a * sin_w * sin_i;
+    orbit->qx = b * (-sin_w * cos_n - cos_w * sin_n * cos_i);
+    orbit->qy = b * (-sin_w * sin_n + cos_w * cos_n * cos_i);
+    orbit->qz = b * cos_w * sin_i;
+  }
+  s_orbits_ready = true;
+}
+#endif
+
+static void sun_terms(float d, SunTerms *sun) {
+  float M = solarMeanAnomaly(d);
+  float cos_M = cos_pebble(M);
+  float C = rad * equation_of_centre(M);
+  float L = M + C + rad * 102.9372 + pi;
+  sun->cos_M = cos_M;
+  sun->sin_L = sin_pebble(L);
+  sun->cos_L = cos_pebble(L);
+  // only the planets need the distance; cos(2M) from the double angle formula
+  sun->distance = 1.00014 - 0.01671 * cos_M - 0.00014 * (2 * cos_M * cos_M - 1);
+}
+
+static void moon_ecliptic(float d, float *sin_l, float *cos_l, float *sin_b, float *cos_b) {
+  float L = rad * (218.316 + 13.176396 * d); // ecliptic longitude
+  float M = rad * (134.963 + 13.064993 * d); // mean anomaly
+  float F = rad * (93.272 + 13.229350 * d);  // mean distance
+
+  float l  = L + rad * 6.289 * sin_pebble(M); // longitude
+  *sin_b = sin_pebble(rad * 5.128 * sin_pebble(F)); // latitude, always within about 5 degrees
+  *cos_b = 1 - *sin_b * *sin_b * (0.5f + 0.125f * *sin_b * *sin_b);
+  *sin_l = sin_pebble(l);
+  *cos_l = cos_pebble(l);
+}
+
+#ifndef SKYPATH_WORKER
+// 1/sqrt(x) for any positive x: a first guess from the float's exponent,
+// then Newton iteration
+static float inv_sqrt(float x) {
+  union { float f; uint32_t i; } u;
+  u.f = x;
+  u.i = 0x5f3759df - (u.i >> 1);
+  float y = u.f;
+  y = y * (1.5f - 0.5f * x * y * y);
+  y = y * (1.5f - 0.5f * x * y * y);
+  y = y * (1.5f - 0.5f * x * y * y);
+  return y;
+}
+
+static void planet_ecliptic(float d, const SunTerms *sun, int planet_index,
+                            float *sin_l, float *cos_l, float *sin_b, float *cos_b) {
+  const PlanetElements *planet = &s_planets[planet_index];
+  const PlanetOrbit *orbit = &s_orbits[planet_index];
+  float M = rad * (planet->L + planet->L_rate * d - planet->peri);
+
+  // eccentric anomaly; the Newton step is small enough to turn sin and cos
+  // through by the small angle formulas
+  float sin_M = sin_pebble(M);
+  float E = M + planet->e * sin_M * (1 + planet->e * cos_pebble(M));
+  float sin_E = sin_pebble(E);
+  float cos_E = cos_pebble(E);
+  float step = (M - E + planet->e * sin_E) / (1 - planet->e * cos_E);
+  float sin_E1 = sin_E + step * cos_E;
+  cos_E = cos_E - step * sin_E;
+  sin_E = sin_E1;
+
+  // along the orbit's axes, then seen from the earth, which is opposite the sun
+  float u = cos_E - planet->e;
+  float x = orbit->px * u + orbit->qx * sin_E + sun->distance * sun->cos_L;
+  float y = orbit->py * u + orbit->qy * sin_E + sun->distance * sun->sin_L;
+  float z = orbit->pz * u + orbit->qz * sin_E;
+  float xy2 = x * x + y * y;
+  float inv_xy = inv_sqrt(xy2);
+  float inv_r = inv_sqrt(xy2 + z * z);
+  *sin_l = y * inv_xy;
+  *cos_l = x * inv_xy;
+  *sin_b = z * inv_r;
+  *cos_b = xy2 * inv_xy * inv_r;
+}
+#endif
+
+void sky_bodies_observer(const SkyObserver *obs, const SkyBody bodies[], int count, float azi[], float alt[]) {
+  float d = toDays(obs->time);
+  float sin_l, cos_l, sin_b, cos_b;
+  SunTerms sun;
+  bool have_sun = false;
+  int i;
+
+  for (i=0;i<count;i++) {
+    if ((bodies[i] != SKY_BODY_MOON) && !have_sun) {
+      sun_terms(d, &sun);
+      have_sun = true;
+    }
+    switch (bodies[i]) {
+      case SKY_BODY_SUN:
+        // ecliptic latitude is 0 for the sun
+        sin_l = sun.sin_L;
+        cos_l = sun.cos_L;
+        sin_b = 0;
+        cos_b = 1;
+        break;
+      case SKY_BODY_MOON:
+        moon_ecliptic(d, &sin_l, &cos_l, &sin_b, &cos_b);
+        break;
+      default:
+#ifdef SKYPATH_WORKER
+        // the worker has no planets
+        azi[i] = alt[i] = 0;
+        continue;
+#else
+        if (!s_orbits_ready) init_orbits();
+        planet_ecliptic(d, &sun, bodies[i] - SKY_BODY_VENUS, &sin_l, &cos_l, &sin_b, &cos_b);
+        break;
+#endif
+    }
+    observer_ecliptic(obs, sin_l, cos_l, sin_b, cos_b, &azi[i], &alt[i]);
+  }
+}
+
+void sky_bodies_hours(time_t day_start, int first, int last, float lat, float lng,
+                      const SkyBody bodies[], int count, float *elev[], float *azi[]) {
+  float body_azi[SKY_BODY_COUNT], body_alt[SKY_BODY_COUNT];
+  int i, k;
+  SkyObserver obs;
+  if (count > SKY_BODY_COUNT) count = SKY_BODY_COUNT;
+  sky_observer_init(&obs, lat, lng, day_start + first * 3600, 3600);
+
+  // every body at each of the requested hours in one pass
+  for (i=first;i<=last;i++) {
+    sky_bodies_observer(&obs, bodies, count, body_azi, body_alt);
+    for (k=0;k<count;k++) {
+      elev[k][i] = body_alt[k] * deg_conv;
+      azi[k][i] = fmod_pebble(((body_azi[k] + pi) * deg_conv ),360);
+    }
+    // advance to the next hour
+    sky_observer_advance(&obs);
+  }
+}
+
+// moon illumination, after suncalc's getMoonIllumination and the
+// parallactic angle from getMoonPosition
+//
+// The moon is close enough that the sun-earth-moon phase angle is taken as
+// 180 degrees less the moon's elongation, so only its cosine is needed and
+// no arccosine.
+
+void moonIllumination(time_t unixdate, float lat, float lng, float *fraction, float *zenith_angle) {
+  float d = toDays(unixdate);
+  float phi = rad * lat;
+
+  float sun_dec, sun_ra, moon_ra, moon_dec;
+  sunCoords(d, &sun_dec, &sun_ra);
+  moonCoords(d, &moon_ra, &moon_dec);
+
+  float sin_sd = sin_pebble(sun_dec), cos_sd = cos_pebble(sun_dec);
+  float sin_md = sin_pebble(moon_dec), cos_md = cos_pebble(moon_dec);
+  float cos_dra = cos_pebble(sun_ra - moon_ra);
+
+  // cosine of the elongation, the sun-moon angle seen from the earth
+  float cos_elong = sin_sd * sin_md + cos_sd * cos_md * cos_dra;
+  *fraction = (1 - cos_elong) / 2;
+
+  // bright limb position angle, eastward from north
+  float angle = atan2_pebble(cos_sd * sin_pebble(sun_ra - moon_ra), sin_sd * cos_md - cos_sd * sin_md * cos_dra);
+
+  // parallactic angle, scaled through by cos(phi) so it holds up to the poles
+  float H = siderealTime(d, rad * -lng) - moon_ra;
+  float q = atan2_pebble(sin_pebble(H) * cos_pebble(phi), sin_pebble(phi) * cos_md - cos_pebble(phi) * sin_md * cos_pebble(H));
+
+  *zenith_angle = angle - q;
+}
+
+// Greatly simplified moon phase algorithm from
+// http://jivebay.com/calculating-the-moon-phase/
+// This simply takes a new moon and uses the moon cycle from there.
+// The function returns an integer between 0 and 29 that is the days
+// into the lunar cycle.  Thus, 0 is new moon, 15 is full moon, and 29 is new
+
+int moonPhase(time_t unixdate) {
+#ifdef EPHEMERIS_FIXED_POINT
+  return moonPhaseFixed(unixdate);
+#else
+  float d = toDays(unixdate);
+  // 2016-Nov-29 12:19:25 UTC was a new moon
+  // 2016-Nov-29 12:19:25 UTC 1480421975 seconds (unix time)
+  // and from earlier, "d" has zero at 946684800 seconds, so 
+  // the "d" value of 2016-Nov-29 12:19:25 UTC = 6177.514 days
+  return ((int)fmod_pebble((d-6177.514),29.5305882));
+#endif
+}
+
+time_t local_midnight(time_t when) {
+  // get the date in local time
+  struct tm *curr_time = localtime(&when);
+  // set hour, minute, and second to 0, so that we'll calculate hourly
+  curr_time->tm_min = 0;
+  curr_time->tm_sec = 0;
+  curr_time->tm_hour = 0;
+  return mktime(curr_time);
+}
+
+void sky_paths_hours(time_t day_start, int first, int last, float lat, float lng, float solar_elev[], float solar_azi[], float lunar_elev[], float lunar_azi[]) {
+#ifdef EPHEMERIS_FIXED_POINT
+  sky_paths_hours_fixed(day_start, first, last, lat, lng, solar_elev, solar_azi, lunar_elev, lunar_azi);
+#else
+  static const SkyBody bodies[] = { SKY_BODY_SUN, SKY_BODY_MOON };
+  float *elev[] = { solar_elev, lunar_elev };
+  float *azi[] = { solar_azi, lunar_azi };
+  sky_bodies_hours(day_start, first, last, lat, lng, bodies, 2, elev, azi);
+#endif
+}
+
@@ -0,0 +1,108 @@
+#pragma once
+#ifdef SKYPATH_WORKER
+#include <pebble_worker.h>
+#else
+#include <pebble.h>
+#endif
+//
+// Sun and moon ephemeris, a port of suncalc (see ephemeris.c)
+//
+// Two engines are available.  The default works in float, like the original
+// javascript.  Defining EPHEMERIS_FIXED_POINT switches the table builder to
+// the integer-only engine in ephemeris_fixed.c, for watches without an FPU
+// where every float operation becomes a software library call.
+//
+// #define EPHEMERIS_FIXED_POINT
+
+// The background worker only builds the sun and moon tables, with the float
+// engine: it has neither the fixed point engine nor the planets, to keep
+// its image small
+#ifdef SKYPATH_WORKER
+#undef EPHEMERIS_FIXED_POINT
+#endif
+
+// date/time constants and conversions
+extern float pi;
+extern float rad;
+extern float daySecs;
+extern time_t J2000;
+extern float deg_conv;
+
+// trig wrappers: sine and cosine around the Pebble lookups, arcsine and
+// arctangent from the generated tables in ephemeris_tables.h
+float sin_pebble(float angle_radians);
+float asin_pebble(float angle_radians);
+float cos_pebble(float angle_radians);
+float atan2_pebble(float y, float x);
+float fmod_pebble(float product, float divisor);
+
+float toDays(time_t unixdate);
+
+// general calculations for position
+float rightAscension(float l, float b);
+float declination(float l, float b);
+float azimuth(float H, float phi, float dec);
+float altitude(float H, float phi, float dec);
+float siderealTime(float d, float lw);
+
+// sun calculations
+float solarMeanAnomaly(float d);
+float eclipticLongitude(float M);
+void sunCoords(float d, float *dec, float *ra);
+void sunPosition(time_t unixdate, float lat, float lng, float *azi, float *alt);
+
+// moon calculations
+void moonCoords(float d, float *ra, float *dec);
+void moonPosition(time_t unixdate, float lat, float lng, float *azi, float *alt);
+int moonPhase(time_t unixdate);
+// illuminated fraction of the moon (0..1), and the angle of the middle of
+// its bright limb from the observer's zenith, radians counterclockwise
+void moonIllumination(time_t unixdate, float lat, float lng, float *fraction, float *zenith_angle);
+
+// Observer context for evenly spaced samples at one location: caches the
+// latitude and obliquity terms and steps the sidereal angle by rotation.
+typedef struct SkyObserver {
+  float sin_phi, cos_phi;      // observer latitude
+  float sin_e, cos_e;          // obliquity of the Earth
+  float lw;                    // west longitude, radians
+  float sin_theta, cos_theta;  // sidereal angle at the current sample
+  float sin_step, cos_step;    // sidereal rotation per step
+  int step_secs;
+  int steps_since_sync;
+  time_t time;                 // current sample
+} SkyObserver;
+
+void sky_observer_init(SkyObserver *obs, float lat, float lng, time_t start, int step_secs);
+void sky_observer_advance(SkyObserver *obs);
+
+// Batched engine: several bodies at the observer's current sample, sharing
+// the day number, the sidereal angle and the sun's position (which places
+// the earth for the planets).  The planets use the float engine only.
+typedef enum {
+  SKY_BODY_SUN,
+  SKY_BODY_MOON,
+  SKY_BODY_VENUS,
+  SKY_BODY_MARS,
+  SKY_BODY_JUPITER,
+  SKY_BODY_COUNT
+} SkyBody;
+
+void sky_bodies_observer(const SkyObserver *obs, const SkyBody bodies[], int count, float azi[], float alt[]);
+// hourly tables for the bodies, in degrees like sky_paths_hours: elev[k] and
+// azi[k] are the tables for bodies[k]
+void sky_bodies_hours(time_t day_start, int first, int last, float lat, float lng,
+                      const SkyBody bodies[], int count, float *elev[], float *azi[]);
+
+// Integer-only engine.  Angles (lat, lng, azi, alt) are in TRIG_MAX_ANGLE
+// units, ratios are Q16 (TRIG_MAX_RATIO).  Azimuth and altitude follow the
+// float engine's conventions, and its arcsine table, so that both build the
+// same tables.
+void sunPositionFixed(time_t unixdate, int32_t lat, int32_t lng, int32_t *azi, int32_t *alt);
+void moonPositionFixed(time_t unixdate, int32_t lat, int32_t lng, int32_t *azi, int32_t *alt);
+int moonPhaseFixed(time_t unixdate);
+void sky_paths_hours_fixed(time_t day_start, int first, int last, float lat, float lng, float solar_elev[], float solar_azi[], float lunar_elev[], float lunar_azi[]);
+
+// hourly sky path tables, in degrees: hours first..last of the day starting
+// at day_start are written to index first..last of each table
+time_t local_midnight(time_t when);
+void sky_paths_hours(time_t day_start, int first, int last, float lat, float lng, float solar_elev[], float solar_azi[], float lunar_elev[], float lunar_azi[]);
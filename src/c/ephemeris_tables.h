@@ -0,0 +1,42 @@
+#pragma once
+#include <stdint.h>
+//
+// Lookup tables for the ephemeris kernels
+//
+// The tables are generated at build time into ephemeris_tables.c, by
+// tools/ephemeris_tables.py from the sizes below (wscript and host/Makefile
+// both run it).  They are const, so they go in with the code and take no
+// heap.  Angles in them are in table units, TABLE_QUARTER_TURN to a quarter
+// turn, and the kernels interpolate linearly between entries.
+//
+// The arcsine steepens without limit towards a sine of 1, so the last
+// 1/ASIN_TAIL_FRACTION of it has a finer table of its own; even so the last
+// half degree below the zenith is only good to about 0.2 degrees.
+//
+
+#define TABLE_QUARTER_TURN 32768
+
+#define ASIN_TABLE_STEPS 512       // arcsine over sines 0..1
+#define ASIN_TAIL_STEPS 256        // and over the last 1/ASIN_TAIL_FRACTION of them
+#define ASIN_TAIL_FRACTION 64
+#define ATAN_TABLE_STEPS 256       // arctangent over ratios 0..1
+#define CENTRE_TABLE_STEPS 256     // the sun's equation of centre over a turn of mean anomaly
+#define CENTRE_TABLE_SCALE 10000   // equation of centre entries per degree
+
+extern const uint16_t ephemeris_asin_table[ASIN_TABLE_STEPS + 1];
+extern const uint16_t ephemeris_asin_tail_table[ASIN_TAIL_STEPS + 1];
+extern const uint16_t ephemeris_atan_table[ATAN_TABLE_STEPS + 1];
+extern const int16_t ephemeris_centre_table[CENTRE_TABLE_STEPS + 1];
+
+// a table of steps + 1 entries at position, in 1/256ths of a step
+static inline int32_t table_interpolate(const uint16_t table[], int steps, int32_t position) {
+  int32_t i = position >> 8;
+  if (i >= steps) return table[steps];
+  return table[i] + (((table[i+1] - table[i]) * (position & 0xff)) >> 8);
+}
+
+static inline int32_t table_interpolate_signed(const int16_t table[], int steps, int32_t position) {
+  int32_t i = position >> 8;
+  if (i >= steps) return table[steps];
+  return table[i] + (((table[i+1] - table[i]) * (position & 0xff)) >> 8);
+}
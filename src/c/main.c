@@ -1,7 +1,25 @@
 #include <pebble.h>
+#include "ephemeris.h"
+#include "sky_store.h"
+#include "sky_cache.h"
+#include "settings.h"
+#include "skypath_worker.h"
+#include "sky_phone.h"
+#include "bitmap_cache.h"
+#include "moon_render.h"
+#include "sky_events.h"
+#include "sky_graph.h"
+#include "sky_path.h"
+#include "sky_profile.h"
+#include "sky_preview.h"
 //
 // First attempt at the skypath (sun and moon) watchface "ephemeris"
 //
+
+// The moon is drawn from its computed illumination (moon_render.h); define
+// this to go back to the nine phase bitmaps
+// #define MOON_PHASE_BITMAPS
+
 static Window *s_main_window;
 // set up text layers for time and date and info information
 static TextLayer *s_time_layer;
@@ -9,330 +27,609 @@ static TextLayer *s_date_layer;
 static TextLayer *s_info_layer;
 // set up canvas layer for drawing
 static Layer *s_canvas_layer;
-// set up sun bitmaps
+// set up sun bitmaps, shared handles from the bitmap cache
 static GBitmap *s_bitmap_sun;
 static GBitmap *s_bitmap_horizon;
+#ifdef MOON_PHASE_BITMAPS
 static GBitmap *s_bitmap_moon;
+#endif
 
 // Global variables
-static float graph_width, graph_height;
-static float curr_solar_elev, curr_solar_azi, curr_lunar_elev, curr_lunar_azi;
-static float solar_elev[25];
-static float solar_azi[25];
-static float lunar_elev[25];
-static float lunar_azi[25];
+// where the sun and moon are now, and where that puts them on the screen;
+// see "Sky state" below
+#define SKY_PLANETS 3   // Venus, Mars and Jupiter, drawn as dots
+
+typedef struct SkyState {
+  bool placed;   // false until the day shown has its tracks
+  float solar_elev, solar_azi, lunar_elev, lunar_azi;
+  GPoint sun;    // top left corners of the sprites
+  GPoint moon;
+  GPoint planets[SKY_PLANETS];   // centres of the dots
+  bool planet_up[SKY_PLANETS];
+} SkyState;
+static SkyState s_sky;
 static int lunar_day;
-
-// Persistent storage key
-#define SETTINGS_KEY 1
-
-// Define our settings struct
-typedef struct ClaySettings {
-  float Latitude;
-  float Longitude;
-  bool ShowInfo;
-} ClaySettings;
+#ifdef SKY_PROFILE
+// time spent drawing the moon since the image was last loaded, to compare
+// the procedural moon with the bitmaps
+static int s_moon_draw_ms;
+static int s_moon_draws;
+#endif
+// the sun and moon tracks themselves are in the track store, sky_store.h
 
 // An instance of the struct
 static ClaySettings settings;
 
-//
-// Adapted from the javascript code below to C
-//
-// https://github.com/mourner/suncalc/blob/master/suncalc.js
-//
-//
-// (c) 2011-2015, Vladimir Agafonkin
-// SunCalc is a JavaScript library for calculating sun/moon position and light phases.
-// https://github.com/mourner/suncalc
-//
-// sun calculations are based on http://aa.quae.nl/en/reken/zonpositie.html formulas
-
-// date/time constants and conversions
-
-float pi = 3.14159268;
-float rad = 3.14159268 / 180;
-float daySecs = 60 * 60 * 24;
-time_t J2000 = 946684800; // year 2000 in unix time
-float deg_conv = 180 / 3.14159268;
-
-float sin_pebble(float angle_radians) {
-  int32_t angle_pebble = angle_radians * TRIG_MAX_ANGLE / (2*pi);
-  return ((float)(sin_lookup(angle_pebble)) / (float)TRIG_MAX_RATIO);
+// see "Sky path drawing" below
+static void invalidate_sky_paths();
+#ifdef SKY_PROFILE
+static void report_frame_times();
+#endif
+// see "Sky state" below
+static void update_sky_state(bool redraw);
+static void mark_sky_dirty();
+
+// a day previewed with a tap, see "Preview" below; NULL when showing now
+static const SkyPreviewDay *s_preview;
+static SkyPreviewStep s_preview_step;
+static void end_preview();
+
+// recomputes over the day, see "Location updates" below
+static int s_location_moves;     // moves big enough to recompute for
+static int s_location_ignored;   // updates too small to show
+static int s_days_calculated;    // day tables worked out on the watch
+static void report_recomputes();
+
+// staging tables for a day being calculated or received, see below
+static float staged_solar_elev[25];
+static float staged_solar_azi[25];
+static float staged_lunar_elev[25];
+static float staged_lunar_azi[25];
+
+// put any of the store's days it is missing in from the cache
+static void fill_sky_store() {
+  time_t start = sky_store_start();
+  int i;
+  for (i=0;i*24<sky_store_hours();i++) {
+    // midday of the day i days on, so daylight saving changes don't matter
+    time_t day = local_midnight(start + i * 86400 + 12 * 3600);
+    if (!sky_store_contains(day)) {
+      const SkyCacheTracks *tracks = sky_cache_read(day, settings.Latitude, settings.Longitude);
+      if (tracks) sky_store_put_tracks(day, tracks);
+    }
+  }
 }
 
-float asin_pebble(float angle_radians) {
-  return (angle_radians);  // use small angle formula.
+void redo_sky_paths() {
+  // the sky paths from today on, from the cache if they are there, and
+  // today re-calculated if it isn't
+  PROFILE_START(tables);
+  time_t today = local_midnight(time(NULL));
+  sky_store_advance(today);
+  fill_sky_store();
+  if (sky_store_contains(today)) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Loaded sky paths from cache");
+  }
+  else {
+    sky_paths_hours(today, 0, 24, settings.Latitude, settings.Longitude, staged_solar_elev, staged_solar_azi, staged_lunar_elev, staged_lunar_azi);
+    sky_cache_store(today, settings.Latitude, settings.Longitude, staged_solar_elev, staged_solar_azi, staged_lunar_elev, staged_lunar_azi);
+    sky_store_put_day(today, staged_solar_elev, staged_solar_azi, staged_lunar_elev, staged_lunar_azi);
+    s_days_calculated++;
+    PROFILE_COUNT(SKY_PROFILE_DAYS_CALCULATED);
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Re-calculated sky paths");
+  }
+  PROFILE_END(tables, SKY_PROFILE_TABLES);
+  invalidate_sky_paths();
 }
 
-float cos_pebble(float angle_radians) {
-  int32_t angle_pebble = angle_radians * TRIG_MAX_ANGLE / (2*pi);
-  return ((float)cos_lookup(angle_pebble) / (float)TRIG_MAX_RATIO);
+#ifdef SKY_PROFILE
+static void report_moon_drawing(int heap_bytes) {
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Moon: %d bytes of heap, drawn %d times in %d ms",
+          heap_bytes, s_moon_draws, s_moon_draw_ms);
+  s_moon_draws = 0;
+  s_moon_draw_ms = 0;
 }
-
-float atan2_pebble(float y, float x) {
-  if (x>2) APP_LOG(APP_LOG_LEVEL_DEBUG, "atan2: X too large, 100 x value = %d", (int)x);
-  if (y>2) APP_LOG(APP_LOG_LEVEL_DEBUG, "atan2: Y too large, 100 x value = %d", (int)y);
-  int16_t y_pebble = (int16_t) (8192 * y ); 
-  int16_t x_pebble = (int16_t) (8192 * x ); 
-  return (2*pi * (float)atan2_lookup(y_pebble, x_pebble) / (float)TRIG_MAX_ANGLE);
+#endif
+
+// the moon images return true if the moon now looks different
+
+#ifndef MOON_PHASE_BITMAPS
+static bool show_moon(int phase, float fraction, float zenith_angle) {
+  bool changed;
+  PROFILE_START(image);
+  lunar_day = phase;
+  // only re-drawn into the mask if the change would show
+  changed = moon_render_update(fraction, zenith_angle);
+#ifdef SKY_PROFILE
+  report_moon_drawing(moon_render_bytes());
+#endif
+  PROFILE_END(image, SKY_PROFILE_IMAGES);
+  return changed;
 }
 
-float fmod_pebble(float product, float divisor) {
-  int32_t factor;
-  float remainder;
-  
-  factor = (int32_t)(product/divisor);
-  if (product<0) factor--;    // casting to int truncates so check if negative and decrement
-  remainder = product - ((float)factor)*divisor;
-  return remainder;
+static bool load_moon_image() {
+  time_t temp = time(NULL);
+  float fraction, zenith_angle;
+  moonIllumination(temp, settings.Latitude, settings.Longitude, &fraction, &zenith_angle);
+  return show_moon(moonPhase(temp), fraction, zenith_angle);
 }
+#else
+static bool show_moon(int phase, float fraction, float zenith_angle) {
+  uint32_t resource_id;
+  GBitmap *old_moon = s_bitmap_moon;
+  PROFILE_START(image);
 
-float toDays(time_t unixdate) {
-  return ((float)(unixdate-J2000) / daySecs -0.5);
+  lunar_day = phase;
+  if (lunar_day < 3)
+    resource_id = RESOURCE_ID_IMAGE_MOON1;
+  else if (lunar_day < 6)
+    resource_id = RESOURCE_ID_IMAGE_MOON2;
+  else if (lunar_day < 10)  // half moon -- 4 days
+    resource_id = RESOURCE_ID_IMAGE_MOON3;
+  else if (lunar_day < 13)
+    resource_id = RESOURCE_ID_IMAGE_MOON4;
+  else if (lunar_day < 16)
+    resource_id = RESOURCE_ID_IMAGE_MOON5;
+  else if (lunar_day < 19)
+    resource_id = RESOURCE_ID_IMAGE_MOON6;
+  else if (lunar_day < 23) // half moon -- 4 days
+    resource_id = RESOURCE_ID_IMAGE_MOON7;
+  else if (lunar_day < 26)
+    resource_id = RESOURCE_ID_IMAGE_MOON8;
+  else
+    resource_id = RESOURCE_ID_IMAGE_MOON9;
+  // only reloaded when the image changes
+  s_bitmap_moon = bitmap_cache_switch(s_bitmap_moon, resource_id);
+  
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Selected moon image for lunar day (moon phase 0-29) %d", lunar_day);
+#ifdef SKY_PROFILE
+  report_moon_drawing(bitmap_cache_bytes(s_bitmap_moon));
+#endif
+  PROFILE_END(image, SKY_PROFILE_IMAGES);
+  return s_bitmap_moon != old_moon;
 }
 
-// general calculations for position
-
-float e = 3.14159268 / 180 * 23.4397; // obliquity of the Earth
-
-float rightAscension(float l, float b) {
-  return atan2_pebble(sin_pebble(l) * cos_pebble(e) - sin_pebble(b)/cos_pebble(b) * sin_pebble(e), cos_pebble(l));
+static bool load_moon_image() {
+  return show_moon(moonPhase(time(NULL)), 0, 0);
 }
-
-float declination(float l, float b) { 
-  return (asin_pebble(sin_pebble(b) * cos_pebble(e) + cos_pebble(b) * sin_pebble(e) * sin_pebble(l)));
+#endif
+
+// pick the sun image for its elevation; true if it changed
+static bool load_sun_image() {
+  GBitmap *old_sun = s_bitmap_sun;
+  PROFILE_START(image);
+  if (s_sky.solar_elev <= 0) {
+    s_bitmap_sun = bitmap_cache_switch(s_bitmap_sun, RESOURCE_ID_IMAGE_SUN_RIM);
+  }
+  else {
+    s_bitmap_sun = bitmap_cache_switch(s_bitmap_sun, RESOURCE_ID_IMAGE_SUN_RISEN);
+  }
+  PROFILE_END(image, SKY_PROFILE_IMAGES);
+  if (s_bitmap_sun == old_sun) return false;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Selected %s sun, elev = %d",
+          (s_sky.solar_elev <= 0) ? "set" : "risen", (int)s_sky.solar_elev);
+  return true;
 }
 
-float azimuth(float H, float phi, float dec) {
-  return (atan2_pebble(sin_pebble(H), cos_pebble(H) * sin_pebble(phi) - sin_pebble(dec)/cos_pebble(dec) * cos_pebble(phi)));
+//
+// Hourly recompute scheduler
+//
+// Rather than blocking the minute tick for the whole table rebuild, the
+// recompute is deferred onto an app_timer and split into resumable steps of
+// a few hourly samples each.  Samples are written into staging tables and
+// only put in the track store once the whole day is done, so the canvas
+// never draws a half-updated path.  Between steps the event loop is free to
+// redraw, deliver AppMessages and update the time text.
+//
+// Every finished day goes into the persistent cache, and into the track
+// store if it falls in the horizon.  Once today is done, the next days are
+// precomputed the same way, so the midnight rollover (and the next launch)
+// only has to read them back.
+//
+// With the phone ephemeris setting on, missing days are asked of the phone
+// first (sky_phone.h), and the watch only calculates them itself if they
+// haven't arrived PHONE_WAIT_MS later.
+
+#define RECOMPUTE_DELAY_MS 5000       // wait 5 seconds after the hour before re-calculating
+#define PRECOMPUTE_DELAY_MS 10000     // start on the coming days once things are quiet
+#define RECOMPUTE_STEP_GAP_MS 50      // pause between steps to let the event loop run
+#define RECOMPUTE_HOURS_PER_STEP 5    // hourly samples calculated per timer callback
+#define RECOMPUTE_IDLE -1
+#define RECOMPUTE_IMAGES 25           // final step, after hourly samples 0..24
+#define PHONE_WAIT_MS 20000           // time the phone gets to send tables before the watch calculates them
+
+static AppTimer *s_recompute_timer;
+static int s_recompute_step = RECOMPUTE_IDLE;  // next hourly sample to calculate
+static time_t s_recompute_day;                 // local midnight of the day being calculated
+
+#ifdef SKY_PROFILE
+static uint16_t s_recompute_max_block_ms;      // longest time a single step held the event loop
+
+// launch time, until the first frame has been drawn
+static time_t s_launch_s;
+static uint16_t s_launch_ms;
+static bool s_first_frame_drawn;
+
+static int ms_since(time_t start_s, uint16_t start_ms) {
+  time_t now_s;
+  uint16_t now_ms;
+  time_ms(&now_s, &now_ms);
+  return (int)(now_s - start_s) * 1000 + now_ms - start_ms;
 }
+#endif
 
-float altitude(float H, float phi, float dec) { 
-  return (asin_pebble(sin_pebble(phi) * sin_pebble(dec) + cos_pebble(phi) * cos_pebble(dec) * cos_pebble(H))); 
-}
+static void schedule_recompute(time_t day, uint32_t delay_ms);
 
-float siderealTime(float d, float lw) { 
-  return (rad * (280.16 + 360.9856235 * d) - lw);
+// queue the first of the coming days that isn't cached yet, unless the
+// background worker is running and doing that for us
+static void schedule_precompute() {
+  time_t today = local_midnight(time(NULL));
+  int i;
+  if (s_recompute_step != RECOMPUTE_IDLE) return;
+  if (settings.BackgroundWorker && app_worker_is_running()) return;
+  for (i=1;i<SKY_CACHE_DAYS;i++) {
+    // midday of the day i days ahead, so daylight saving changes don't matter
+    time_t day = local_midnight(today + i * 86400 + 12 * 3600);
+    if (!sky_cache_contains(day, settings.Latitude, settings.Longitude)) {
+      schedule_recompute(day, settings.PhoneEphemeris ? PHONE_WAIT_MS : PRECOMPUTE_DELAY_MS);
+      return;
+    }
+  }
 }
 
-// general sun calculations
-
-float solarMeanAnomaly(float d) { 
-  return (rad * (357.5291 + 0.98560028 * d)); 
+// with the phone ephemeris on, ask the phone for the coming days if any of
+// them aren't cached yet; true if it was asked
+static bool request_phone_tables() {
+  time_t today = local_midnight(time(NULL));
+  int i;
+  if (!settings.PhoneEphemeris) return false;
+  for (i=0;i<SKY_CACHE_DAYS;i++) {
+    time_t day = local_midnight(today + i * 86400 + 12 * 3600);
+    if (!sky_cache_contains(day, settings.Latitude, settings.Longitude)) {
+      return sky_phone_request(today, SKY_CACHE_DAYS, settings.Latitude, settings.Longitude);
+    }
+  }
+  return false;
 }
 
-float eclipticLongitude(float M) {
-  float C = rad * (1.9148 * sin_pebble(M) + 0.02 * sin_pebble(2 * M) + 0.0003 * sin_pebble(3 * M)); // equation of center
-  float P = rad * 102.9372; // perihelion of the Earth
-  return (M + C + P + pi);
+// put the staged tables in the track store, and if they are today's pick
+// images to match
+static void publish_staged_tables(time_t day) {
+  sky_store_put_day(day, staged_solar_elev, staged_solar_azi, staged_lunar_elev, staged_lunar_azi);
+  if (day == local_midnight(time(NULL))) {
+    // load a moon image (maybe a new one); the sun's goes with the sky state
+    load_moon_image();
+    invalidate_sky_paths();
+  }
 }
 
-void sunCoords(float d, float *dec, float *ra) {
+static void recompute_step(void *data) {
+#ifdef SKY_PROFILE
+  time_t start_s;
+  uint16_t start_ms;
+  time_ms(&start_s, &start_ms);
+#endif
+  PROFILE_START(tables);
+
+  if (s_recompute_step < RECOMPUTE_IMAGES) {
+    int last = s_recompute_step + RECOMPUTE_HOURS_PER_STEP - 1;
+    if (last > 24) last = 24;
+    sky_paths_hours(s_recompute_day, s_recompute_step, last, settings.Latitude, settings.Longitude,
+                    staged_solar_elev, staged_solar_azi, staged_lunar_elev, staged_lunar_azi);
+    s_recompute_step = last + 1;
+  }
+  else {
+    // all samples done: keep them, and publish the new tables
+    sky_cache_store(s_recompute_day, settings.Latitude, settings.Longitude,
+                    staged_solar_elev, staged_solar_azi, staged_lunar_elev, staged_lunar_azi);
+    publish_staged_tables(s_recompute_day);
+    s_days_calculated++;
+    PROFILE_COUNT(SKY_PROFILE_DAYS_CALCULATED);
+    if (s_recompute_day == local_midnight(time(NULL))) {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "Re-calculated sky paths");
+    }
+    else {
+      APP_LOG(APP_LOG_LEVEL_DEBUG, "Pre-calculated sky paths for a coming day");
+    }
+    s_recompute_step = RECOMPUTE_IDLE;
+  }
 
-  float M = solarMeanAnomaly(d);
-  float L = eclipticLongitude(M);
+  if (s_recompute_step == RECOMPUTE_IDLE) {
+    s_recompute_timer = NULL;
+    schedule_precompute();
+  }
+  else {
+    s_recompute_timer = app_timer_register(RECOMPUTE_STEP_GAP_MS, recompute_step, NULL);
+  }
 
-  *dec = declination(L, 0);
-  *ra = rightAscension(L, 0);
+  PROFILE_END(tables, SKY_PROFILE_TABLES);
+#ifdef SKY_PROFILE
+  // keep track of the longest time this handler has blocked the event loop
+  int blocked_ms = ms_since(start_s, start_ms);
+  if (blocked_ms > s_recompute_max_block_ms) {
+    s_recompute_max_block_ms = blocked_ms;
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Recompute step blocked for a new maximum of %d ms", blocked_ms);
+  }
+#endif
 }
 
-void sunPosition(time_t unixdate, float lat, float lng, float *azi, float *alt) {
-// calculates sun position for a given date and latitude/longitude
-
-  float lw  = rad * -lng;
-  float phi = rad * lat;
-  float d = toDays(unixdate);
-
-  float dec, ra;
-  sunCoords(d, &dec, &ra);
-  float H  = siderealTime(d, lw) - ra;
-
-  *azi = azimuth(H, phi, dec);
-  *alt = altitude(H, phi, dec);
-};
-
-// moon calculations, based on http://aa.quae.nl/en/reken/hemelpositie.html formulas
+static void schedule_recompute(time_t day, uint32_t delay_ms) {
+  // (re)start the recompute from the first hour of the day
+  if (s_recompute_timer) app_timer_cancel(s_recompute_timer);
+  s_recompute_day = day;
+  s_recompute_step = 0;
+  s_recompute_timer = app_timer_register(delay_ms, recompute_step, NULL);
+}
 
-void moonCoords(float d, float *ra, float *dec) { 
-// geocentric ecliptic coordinates of the moon
+static void cancel_recompute() {
+  if (s_recompute_timer) app_timer_cancel(s_recompute_timer);
+  s_recompute_timer = NULL;
+  s_recompute_step = RECOMPUTE_IDLE;
+}
 
-  float L = rad * (218.316 + 13.176396 * d); // ecliptic longitude
-  float M = rad * (134.963 + 13.064993 * d); // mean anomaly
-  float F = rad * (93.272 + 13.229350 * d);  // mean distance
+static void refresh_sky_paths() {
+  time_t today = local_midnight(time(NULL));
+  bool phone_asked = false;
+  end_preview();
+  bool paths_changed = false;
+  if (today != sky_store_start()) {
+    // a new day: move the store on, keeping the days it already has
+    report_recomputes();
+    sky_cache_evict(today);
+    sky_store_advance(today);
+    phone_asked = request_phone_tables();
+    paths_changed = true;
+  }
+  // read what is new in the cache, and have today sent or calculated if it
+  // isn't there
+  if (!sky_store_contains(today)) paths_changed = true;
+  fill_sky_store();
+  if (!sky_store_contains(today)) {
+    if ((s_recompute_step == RECOMPUTE_IDLE) || (s_recompute_day != today)) {
+      schedule_recompute(today, phone_asked ? PHONE_WAIT_MS : RECOMPUTE_DELAY_MS);
+    }
+    return;
+  }
+  // load a moon image (maybe a new one), and only redraw for new paths or
+  // a moon that looks different
+  bool moon_changed = load_moon_image();
+  if (paths_changed) {
+    invalidate_sky_paths();
+  }
+  else if (moon_changed) {
+    mark_sky_dirty();
+  }
+  schedule_precompute();
+  sky_preview_prefetch(SKY_PREVIEW_TOMORROW, settings.Latitude, settings.Longitude);
+}
 
-  float l  = L + rad * 6.289 * sin_pebble(M); // longitude
-  float b  = rad * 5.128 * sin_pebble(F);     // latitude
+static void receive_phone_tables(DictionaryIterator *iter) {
+  time_t day, today = local_midnight(time(NULL));
+  if (!sky_phone_receive(iter, settings.Latitude, settings.Longitude, &day) || (day < today)) return;
+
+  // the phone's tables replace any the watch is working on, so the staging
+  // tables are free to decode into
+  cancel_recompute();
+  if (sky_phone_decode(staged_solar_elev, staged_solar_azi, staged_lunar_elev, staged_lunar_azi)) {
+    sky_cache_store(day, settings.Latitude, settings.Longitude,
+                    staged_solar_elev, staged_solar_azi, staged_lunar_elev, staged_lunar_azi);
+    publish_staged_tables(day);
+  }
+  if (!sky_store_contains(today)) {
+    schedule_recompute(today, RECOMPUTE_DELAY_MS);
+  }
+  else {
+    schedule_precompute();
+  }
+}
 
-  *ra = rightAscension(l, b);
-  *dec = declination(l, b);
+// start or stop the background worker to match the setting
+static void update_worker() {
+  if (settings.BackgroundWorker && !app_worker_is_running()) app_worker_launch();
+  else if (!settings.BackgroundWorker && app_worker_is_running()) app_worker_kill();
 }
 
-void moonPosition(time_t unixdate, float lat, float lng, float *azi, float *alt) {
-  float lw  = rad * -lng;
-  float phi = rad * lat;
-  float d = toDays(unixdate);
+static void worker_message_handler(uint16_t type, AppWorkerMessage *message) {
+  // the worker has cached a day: take it into the store, and if it is the
+  // today we were waiting for, stop calculating it here
+  time_t today = local_midnight(time(NULL));
+  if (type != WORKER_MSG_TABLES_READY) return;
+  if ((message->data0 == SKY_DAY_NUMBER(today)) && !sky_store_contains(today)) {
+    cancel_recompute();
+    refresh_sky_paths();
+  }
+  else {
+    fill_sky_store();
+  }
+}
 
-  float ra, dec;
-  moonCoords(d, &ra, &dec);
-  float H = siderealTime(d, lw) - ra;
-  float h = altitude(H, phi, dec);
-// formula 14.1 of "Astronomical Algorithms" 2nd edition by Jean Meeus (Willmann-Bell, Richmond) 1998.
+// text layers are only given new text when it changes, as setting it has
+// the window redrawn
+#ifdef SKY_PROFILE
+static int s_text_updates;
+#endif
+
+static void set_text(TextLayer *layer, char *buffer, size_t size, const char *text) {
+  if (strcmp(buffer, text) == 0) return;
+  strncpy(buffer, text, size - 1);
+  buffer[size - 1] = 0;
+  text_layer_set_text(layer, buffer);
+#ifdef SKY_PROFILE
+  s_text_updates++;
+#endif
+  PROFILE_COUNT(SKY_PROFILE_TEXT_UPDATES);
+}
 
-  *azi = azimuth(H, phi, dec);
-  *alt = h;
-};
+//
+// Rise and set times for the info text
+//
+// Solved from today's tracks the first time they are shown each day, and
+// again whenever the paths are rebuilt; see sky_events.h.
 
-// Greatly simplified moon phase algorithm from
-// http://jivebay.com/calculating-the-moon-phase/
-// This simply takes a new moon and uses the moon cycle from there.
-// The function returns an integer between 0 and 29 that is the days
-// into the lunar cycle.  Thus, 0 is new moon, 15 is full moon, and 29 is new
+#define INFO_PAGES 7   // the info text changes every minute, cycling through these
 
-int moonPhase(time_t unixdate) {
-  float d = toDays(unixdate);
-  // 2016-Nov-29 12:19:25 UTC was a new moon
-  // 2016-Nov-29 12:19:25 UTC 1480421975 seconds (unix time)
-  // and from earlier, "d" has zero at 946684800 seconds, so 
-  // the "d" value of 2016-Nov-29 12:19:25 UTC = 6177.514 days
-  return ((int)fmod_pebble((d-6177.514),29.5305882));
-}
+static SkyEvents s_events;   // day is 0 until they are solved
 
-void sky_paths_today(float lat, float lng, float solar_elev[], float solar_azi[], float lunar_elev[], float lunar_azi[]) {
-  float sol_alt, sol_azi, moon_alt, moon_azi;
+// today's events, solved if they haven't been; NULL until today's tracks are in
+static const SkyEvents *sky_events_today() {
+  // kept off the stack, which is small on the watch
+  static float s_solar_elev[25];
+  static float s_lunar_elev[25];
+  time_t today = local_midnight(time(NULL));
   int i;
-  
-  // get today's date in local time  
-  time_t temp = time(NULL);
-  struct tm *curr_time = localtime(&temp);
-  // set hour, minute, and second to 0, so that we'll calculate hourly
-  curr_time->tm_min = 0;
-  curr_time->tm_sec = 0;
-  curr_time->tm_hour = 0;
-  temp = mktime(curr_time);
-
-  // cycle through 25 hours calculating solar and lunar parameters
-  for (i=0;i<25;i++) {
-    // Solar calculation
-    sunPosition(temp, lat, lng, &sol_azi, &sol_alt);
-    solar_elev[i] = sol_alt * deg_conv;
-    solar_azi[i] = fmod_pebble(((sol_azi + pi) * deg_conv ),360);
-//    APP_LOG(APP_LOG_LEVEL_DEBUG, "hour %d Solar: Elev %d  Azi %d", i, (int)solar_elev[i], (int)solar_azi[i]);
-
-    // Lunar calculation
-    moonPosition(temp, lat, lng, &moon_azi, &moon_alt);
-    lunar_elev[i] = moon_alt * deg_conv;
-    lunar_azi[i] = fmod_pebble(((moon_azi + pi) * deg_conv ),360);
-//    APP_LOG(APP_LOG_LEVEL_DEBUG, "       Lunar: Elev %d  Azi %d", (int)lunar_elev[i], (int)lunar_azi[i]);
-    
-    // advance to the next hour
-    temp = temp + 3600;
-  }
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Re-calculated sky paths");
+  if (s_events.day == today) return &s_events;
+  if ((sky_store_start() != today) || !sky_store_contains(today)) return NULL;
+  for (i=0;i<=24;i++) {
+    s_solar_elev[i] = sky_store_eval(SKY_SOLAR_ELEV, i);
+    s_lunar_elev[i] = sky_store_eval(SKY_LUNAR_ELEV, i);
+  }
+  PROFILE_START(events);
+  sky_events_solve(&s_events, today, settings.Latitude, settings.Longitude, s_solar_elev, s_lunar_elev);
+  PROFILE_END(events, SKY_PROFILE_EVENTS);
+  return &s_events;
 }
 
-void redo_sky_paths() {
-  // re-calculate sky paths
-  sky_paths_today(settings.Latitude, settings.Longitude, solar_elev, solar_azi, lunar_elev, lunar_azi);
+// a time of day as the clock shows it
+static void format_event_time(char *text, size_t size, time_t when) {
+  char buffer[8];
+  strftime(buffer, sizeof(buffer), clock_is_24h_style() ? "%k:%M" : "%l:%M", localtime(&when));
+  snprintf(text, size, "%s", (buffer[0] == ' ') ? &(buffer[1]) : buffer);
 }
 
-static void load_moon_image() {
-  // Get a tm structure
-  time_t temp = time(NULL);
+// "Sun 6:12-21:40", or whichever of them happens, or how it stays all day
+static void format_crossings(char *text, size_t size, const char *name, const SkyCrossings *crossings, time_t transit) {
+  char rise[8], set[8];
+  format_event_time(rise, sizeof(rise), crossings->rise);
+  format_event_time(set, sizeof(set), crossings->set);
+  if (crossings->all_day == SKY_UP_ALL_DAY) {
+    // up all day it is still worth knowing when it is highest
+    format_event_time(rise, sizeof(rise), transit);
+    if (transit) snprintf(text, size, "%s high %s", name, rise);
+    else snprintf(text, size, "%s up all day", name);
+  }
+  else if (crossings->all_day == SKY_DOWN_ALL_DAY) snprintf(text, size, "%s down all day", name);
+  else if (crossings->rise && crossings->set) snprintf(text, size, "%s %s-%s", name, rise, set);
+  else if (crossings->rise) snprintf(text, size, "%s up %s", name, rise);
+  else snprintf(text, size, "%s down %s", name, set);
+}
 
-  lunar_day = moonPhase(temp);
-  if (lunar_day < 3)
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON1);
-  if ((lunar_day < 6) && (lunar_day >= 3)) 
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON2);
-  if ((lunar_day < 10) && (lunar_day >= 6))  // half moon -- 4 days
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON3);
-  if ((lunar_day < 13) && (lunar_day >= 10)) 
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON4);
-  if ((lunar_day < 16) && (lunar_day >= 13)) 
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON5);
-  if ((lunar_day < 19) && (lunar_day >= 16)) 
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON6);
-  if ((lunar_day < 23) && (lunar_day >= 19)) // half moon -- 4 days
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON7);
-  if ((lunar_day < 26) && (lunar_day >= 23)) 
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON8);
-  if (lunar_day >= 26) 
-    s_bitmap_moon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_MOON9);
-  
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Selected moon image for lunar day (moon phase 0-29) %d", lunar_day);
+// civil twilight: "Light 4:10-22:31", or the white nights and polar days
+static void format_daylight(char *text, size_t size, const SkyCrossings *civil) {
+  char dawn[8], dusk[8];
+  format_event_time(dawn, sizeof(dawn), civil->rise);
+  format_event_time(dusk, sizeof(dusk), civil->set);
+  if (civil->all_day == SKY_UP_ALL_DAY) snprintf(text, size, "Light all night");
+  else if (civil->all_day == SKY_DOWN_ALL_DAY) snprintf(text, size, "Dark all day");
+  else if (civil->rise && civil->set) snprintf(text, size, "Light %s-%s", dawn, dusk);
+  else if (civil->rise) snprintf(text, size, "Dawn %s", dawn);
+  else snprintf(text, size, "Dusk %s", dusk);
 }
 
-static void load_sun_image() {
-  if (curr_solar_elev <= 0) {
-    s_bitmap_sun = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_SUN_RIM);
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "Selected set sun, elev = %d", (int)curr_solar_elev);
-  }
-  else {
-    s_bitmap_sun = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_SUN_RISEN);
-    APP_LOG(APP_LOG_LEVEL_DEBUG, "Selected SUN risen, elev = %d", (int)curr_solar_elev);
+// what a preview is of, for the info text
+static const char *preview_label(SkyPreviewStep step) {
+  switch (step) {
+    case SKY_PREVIEW_TOMORROW: return "Tomorrow";
+    case SKY_PREVIEW_DAY_AFTER: return "In 2 days";
+    case SKY_PREVIEW_THIRD_DAY: return "In 3 days";
+    case SKY_PREVIEW_FULL_MOON: return "Full moon";
+    default: return " ";
   }
 }
 
-static void update_time() {
-  // Get a tm structure
+static void update_texts() {
+  // Get a tm structure, copied as formatting the event times uses localtime too
   time_t temp = time(NULL);
-  struct tm *tick_time = localtime(&temp);
+  struct tm tick = *localtime(&temp);
+  struct tm *tick_time = &tick;
 
-  // Write the current hours and minutes into a buffer
+  // the text shown in each layer
   static char s_buffer[8];
   static char s_date_buffer[12];
-  static char s_info_buffer[15];
-  
-  strftime(s_buffer, sizeof(s_buffer), clock_is_24h_style() ?
+  static char s_info_buffer[20];
+  char text[20];
+
+  // Write the current hours and minutes into a buffer
+  strftime(text, sizeof(s_buffer), clock_is_24h_style() ?
                                           "%k:%M" : "%l:%M", tick_time);
-//  strftime(s_buffer, sizeof(s_buffer), clock_is_24h_style() ?
+//  strftime(text, sizeof(s_buffer), clock_is_24h_style() ?
 //                                          "%H:%M" : "%I:%M", tick_time);
-  if (s_buffer[0] == ' ') {
-    // cut the leading space
-    text_layer_set_text(s_time_layer, &(s_buffer[1]));
+  // Display this time on the TextLayer, cutting any leading space
+  set_text(s_time_layer, s_buffer, sizeof(s_buffer), (text[0] == ' ') ? &(text[1]) : text);
+  
+  // Update the date text, to the day previewed if there is one
+  if (s_preview) {
+    time_t midday = s_preview->day + 12 * 3600;
+    strftime(text, sizeof(s_date_buffer), "%a, %b %e", localtime(&midday));
   }
   else {
-    text_layer_set_text(s_time_layer, s_buffer);
+    strftime(text, sizeof(s_date_buffer), "%a, %b %e", tick_time);
   }
-  // Display this time on the TextLayer
-  
-  // Update the date text  
-  strftime(s_date_buffer, sizeof(s_date_buffer), "%a, %b %e", tick_time);
-  text_layer_set_text(s_date_layer, s_date_buffer);
+  set_text(s_date_layer, s_date_buffer, sizeof(s_date_buffer), text);
   
   // Update the info text -- if we want to show information
-  if (settings.ShowInfo) {
-    switch ((tick_time->tm_min) % 3) {
+  if (s_preview) {
+    snprintf(text, sizeof(text), "%s", preview_label(s_preview_step));
+  }
+  else if (settings.ShowInfo) {
+    const SkyEvents *events = sky_events_today();
+    char when[8];
+    switch ((tick_time->tm_min) % INFO_PAGES) {
       case 0:
-        snprintf(s_info_buffer, sizeof(s_info_buffer), "Sun [%d|%d]", (int)curr_solar_elev, (int)curr_solar_azi);
-        text_layer_set_text(s_info_layer, s_info_buffer);
+        snprintf(text, sizeof(text), "Sun [%d|%d]", (int)s_sky.solar_elev, (int)s_sky.solar_azi);
         break;
       case 1:
-        snprintf(s_info_buffer, sizeof(s_info_buffer), "Moon [%d|%d]", (int)curr_lunar_elev, (int)curr_lunar_azi);
-        text_layer_set_text(s_info_layer, s_info_buffer);
+        if (events) format_crossings(text, sizeof(text), "Sun", &events->sun, events->solar_noon);
+        else snprintf(text, sizeof(text), " ");
         break;
       case 2:
-        snprintf(s_info_buffer, sizeof(s_info_buffer), "Moon %dd old", moonPhase(temp));
-        text_layer_set_text(s_info_layer, s_info_buffer);
+        if (events && events->solar_noon) {
+          format_event_time(when, sizeof(when), events->solar_noon);
+          snprintf(text, sizeof(text), "Noon %s [%d]", when, events->solar_noon_elev);
+        }
+        else snprintf(text, sizeof(text), " ");
+        break;
+      case 3:
+        if (events) format_daylight(text, sizeof(text), &events->civil);
+        else snprintf(text, sizeof(text), " ");
+        break;
+      case 4:
+        snprintf(text, sizeof(text), "Moon [%d|%d]", (int)s_sky.lunar_elev, (int)s_sky.lunar_azi);
+        break;
+      case 5:
+        if (events) format_crossings(text, sizeof(text), "Moon", &events->moon, events->lunar_transit);
+        else snprintf(text, sizeof(text), " ");
+        break;
+      default:
+        snprintf(text, sizeof(text), "Moon %dd old", moonPhase(temp));
         break;
     }
-      
   }  
   else {
-    snprintf(s_info_buffer, sizeof(s_info_buffer), " ");
-    text_layer_set_text(s_info_layer, s_info_buffer);
+    snprintf(text, sizeof(text), " ");
   }
+  set_text(s_info_layer, s_info_buffer, sizeof(s_info_buffer), text);
+}
+
+static void update_time() {
+  // move the sun and moon on first; the info text shows where they are
+  update_sky_state(false);
+  update_texts();
+
+  time_t temp = time(NULL);
+  struct tm *tick_time = localtime(&temp);
 
   // if it is an hour boundary, re-calculate the sun and moon ephemeris
   if (tick_time->tm_min == 0) {
-    psleep(5000); // wait 5 seconds after the hour before re-calculating
-    // re-calculate skypaths
-    redo_sky_paths();
-    // load a moon image (maybe a new one)
-    load_moon_image();
-    // load a sun image (maybe a new one)
-    load_sun_image();
+#ifdef SKY_PROFILE
+    report_frame_times();
+#endif
+    // pick up a new day's skypaths and new images, off the tick handler
+    refresh_sky_paths();
+  }
+  // profiling builds send what they have timed to the phone, away from the
+  // hourly recompute and its messages
+  if ((tick_time->tm_min == 15) || (tick_time->tm_min == 45)) {
+    PROFILE_SEND();
   }
 }
 
@@ -340,24 +637,364 @@ static void tick_handler(struct tm *tick_time, TimeUnits units_changed) {
   update_time();
 }
 
-int hour_to_xpixel (float hour) {
-  // width = 0 to 24 hours
-  return (int)(hour/24 * graph_width);
+//
+// Sky path drawing
+//
+// The sun and moon paths only change when the tables are rebuilt, the
+// location changes or the layout changes, so they are projected to screen
+// points once then and kept as polylines (sky_path.h), with a flag per
+// segment for whether it is drawn.  Each frame only draws the cached lines and places
+// the sun and moon over them.  Define SKY_PATHS_EVERY_FRAME to project them
+// on every redraw instead, to compare frame times.
+
+// #define SKY_PATHS_EVERY_FRAME
+
+static SkyPath s_solar_path;
+static SkyPath s_lunar_path;
+static float s_midnight_solar_azi;   // the lunar path is placed relative to this
+static bool s_sky_paths_stale = true;
+
+#ifdef SKY_PROFILE
+// frame draw times since they were last reported
+static int s_frame_ms;
+static int s_frame_ms_max;
+static int s_frames;
+
+// redraws the sky state has asked for since the frame times were reported
+static int s_sky_redraws;
+#endif
+
+// true if the day shown has its tracks: a preview always does, today only
+// once it is in the store
+static bool shown_day_ready() {
+  return s_preview || sky_store_contains(local_midnight(time(NULL)));
+}
+
+// the tracks of the day shown: today's from the store, or a preview's
+static float shown_eval(SkyTrack track, float hour) {
+  if (s_preview) return sky_tracks_eval(&s_preview->tracks, track, hour);
+  return sky_store_eval(track, hour);
+}
+
+static void show_sky_paths() {
+  // the scale and the moon's reference azimuth go with the paths, and the
+  // sun and moon are placed again on them
+  sky_graph_set_latitude(settings.Latitude);
+  s_midnight_solar_azi = shown_eval(SKY_SOLAR_AZI, 0);
+  s_sky_paths_stale = true;
+  update_sky_state(true);
+}
+
+static void invalidate_sky_paths() {
+  // the rise and set times are solved again from the new tracks
+  s_events.day = 0;
+  show_sky_paths();
+}
+
+#ifdef SKY_PROFILE
+static void report_frame_times() {
+  // frames are drawn for any change in the window, the time text's too
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Drew %d frames in the hour, %d asked for by the sky, %d text updates",
+          s_frames, s_sky_redraws, s_text_updates);
+  if (s_frames > 0) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Frames took %d ms on average, %d ms at most",
+            s_frame_ms / s_frames, s_frame_ms_max);
+  }
+  s_frames = 0;
+  s_frame_ms = 0;
+  s_frame_ms_max = 0;
+  s_sky_redraws = 0;
+  s_text_updates = 0;
+}
+#endif
+
+static void solar_path_eval(float hour, float *across, float *elev) {
+  *across = hour * 15;
+  *elev = shown_eval(SKY_SOLAR_ELEV, hour);
 }
 
-int angle_to_ypixel (float angle) {
-  // set y scale based upon latitude
-  int range = (90 - settings.Latitude + 23.5) * 1.35;  // full graph 135% of the potential range at that lat
-  if (range>110) range = 110;
-  int top = (90 - settings.Latitude + 23.5) * 1.05;  // this gives a 20% buffer below the horizon.
-  if (top>90) top = 90;
-  return (int)((top-angle)/range * graph_height);
+static void lunar_path_eval(float hour, float *across, float *elev) {
+  // placed by azimuth relative to the sun at midnight
+  *across = fmod_pebble(shown_eval(SKY_LUNAR_AZI, hour) - s_midnight_solar_azi, 360);
+  *elev = shown_eval(SKY_LUNAR_ELEV, hour);
+}
+
+static void project_sky_paths() {
+  int solar_evals = sky_path_build(&s_solar_path, solar_path_eval);
+  int lunar_evals = sky_path_build(&s_lunar_path, lunar_path_eval);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Sky paths: sun %d points from %d samples, moon %d points from %d samples",
+          s_solar_path.count, solar_evals, s_lunar_path.count, lunar_evals);
+  s_sky_paths_stale = false;
+}
+
+//
+// Sky state
+//
+// The current positions of the sun and moon are evaluated once a minute,
+// on the tick, along with where their sprites go on the screen.  The canvas
+// is only marked dirty when a sprite moves by a pixel or changes its image;
+// drawing just reads the state.  Until today's tracks are in the store
+// (at launch, or from midnight until the day is read or calculated) nothing
+// is placed, and the graph is drawn without the paths and sprites.
+
+static void mark_sky_dirty() {
+  if (!s_canvas_layer) return;
+  layer_mark_dirty(s_canvas_layer);
+#ifdef SKY_PROFILE
+  s_sky_redraws++;
+#endif
+  PROFILE_COUNT(SKY_PROFILE_SKY_REDRAWS);
+}
+
+static void update_sky_state(bool redraw) {
+  // with nothing to place, neither the sun's image nor a redraw is picked
+  // from the store; only sprites already up are taken off
+  if (!shown_day_ready()) {
+    if (s_sky.placed) mark_sky_dirty();
+    s_sky.placed = false;
+    return;
+  }
+  s_sky.placed = true;
+  time_t temp = time(NULL);
+  struct tm *curr_time = localtime(&temp);
+  float curr_hour = curr_time->tm_hour + ((float)curr_time->tm_min)/60;
+  float curr_elev, curr_azi;
+  GPoint sun, moon;
+
+  // Calculate sun position
+  s_sky.solar_elev = shown_eval(SKY_SOLAR_ELEV, curr_hour);
+  s_sky.solar_azi = shown_eval(SKY_SOLAR_AZI, curr_hour);
+  curr_elev = s_sky.solar_elev;
+  // If sun is too low, stop lowering its position
+  if (curr_elev < -7) curr_elev = -7;
+  // Get the location to place the sun
+  sun = sky_graph_point(curr_hour * 15, curr_elev);
+  sun.x -= 7;
+  sun.y -= 6;
+
+  s_sky.lunar_elev = shown_eval(SKY_LUNAR_ELEV, curr_hour);
+  s_sky.lunar_azi = shown_eval(SKY_LUNAR_AZI, curr_hour);
+  curr_elev = s_sky.lunar_elev;
+  curr_azi = fmod_pebble(s_sky.lunar_azi - s_midnight_solar_azi,360);  // for display purposes
+  // If moon is too low, stop lowering its position
+  if (curr_elev < -7) curr_elev = -7;
+  // Get the location to place the moon
+  moon = sky_graph_point(curr_azi, curr_elev);
+  moon.x -= 6;
+  moon.y -= 6;
+
+  // the planets aren't in the tables; one batched sample places them all,
+  // placed like the moon
+  static const SkyBody planet_bodies[SKY_PLANETS] = { SKY_BODY_VENUS, SKY_BODY_MARS, SKY_BODY_JUPITER };
+  float planet_azi[SKY_PLANETS], planet_alt[SKY_PLANETS];
+  SkyObserver obs;
+  int k;
+  time_t when = s_preview ? s_preview->day + (temp - local_midnight(temp)) : temp;
+  sky_observer_init(&obs, settings.Latitude, settings.Longitude, when, 60);
+  sky_bodies_observer(&obs, planet_bodies, SKY_PLANETS, planet_azi, planet_alt);
+  for (k=0;k<SKY_PLANETS;k++) {
+    curr_elev = planet_alt[k] * deg_conv;
+    curr_azi = fmod_pebble((planet_azi[k] + pi) * deg_conv - s_midnight_solar_azi, 360);
+    GPoint planet = sky_graph_point(curr_azi, curr_elev);
+    bool up = curr_elev > 0;
+    if ((up != s_sky.planet_up[k]) || (up && ((planet.x != s_sky.planets[k].x) || (planet.y != s_sky.planets[k].y)))) {
+      redraw = true;
+    }
+    s_sky.planets[k] = planet;
+    s_sky.planet_up[k] = up;
+  }
+
+  // a new sun image as it rises or sets
+  if (load_sun_image()) redraw = true;
+  if ((sun.x != s_sky.sun.x) || (sun.y != s_sky.sun.y) ||
+      (moon.x != s_sky.moon.x) || (moon.y != s_sky.moon.y)) {
+    redraw = true;
+  }
+  s_sky.sun = sun;
+  s_sky.moon = moon;
+  if (redraw) mark_sky_dirty();
+}
+
+// Venus, Mars and Jupiter in colour where there is colour
+static GColor planet_color(int planet) {
+  switch (planet) {
+    case 1: return PBL_IF_COLOR_ELSE(GColorRed, GColorWhite);
+    case 2: return PBL_IF_COLOR_ELSE(GColorOrange, GColorWhite);
+    default: return GColorWhite;
+  }
+}
+
+//
+// Layout
+//
+// The canvas takes the top 40% of the window and the time, date and info
+// lines stack under it.  When a Quick View peek covers the bottom of the
+// screen they are laid out again in what it leaves: the info line goes
+// first, then the canvas gets shorter so the time and date still fit.
+//
+// The graph is only projected again once the peek has stopped moving.
+// While it slides, frames draw the paths, sprites and horizon as they were
+// projected, with y scaled by the canvas' height against the height they
+// were projected for.  The graph's y tables are linear in the height, so
+// that puts them within two pixels of where the new projection will, for a
+// multiply per point.  On round displays x is narrowed to the width of the
+// row a point is on, and scaling y alone would leave it at the old row's
+// width, so there the graph isn't scaled while the peek moves: it stays as
+// projected, cut off by the canvas, and is projected again in did_change.
+// Frames drawn while the peek moves are timed apart from the others.
+//
+
+#define TIME_HEIGHT 43
+#define DATE_TOP 43          // from the top of the time
+#define DATE_HEIGHT 26
+#define INFO_TOP 70
+#define INFO_HEIGHT 26
+#define MIN_CANVAS_HEIGHT 20
+
+static GRect s_window_bounds;
+static int s_projected_h;                        // canvas height the graph is projected for
+static int32_t s_y_scale = SKY_PATH_SCALE_ONE;   // and the canvas' height now against it
+
+#ifdef SKY_PROFILE
+// frames drawn while the peek moved
+static bool s_peek_moving;
+static int s_peek_frame_ms;
+static int s_peek_frame_ms_max;
+static int s_peek_frames;
+#endif
+
+// the part of the window no peek covers
+static GRect unobstructed_area(Layer *root) {
+#ifdef PBL_PLATFORM_APLITE
+  return layer_get_bounds(root);
+#else
+  return layer_get_unobstructed_bounds(root);
+#endif
+}
+
+// lay the canvas and text out in area; returns the canvas' frame
+static GRect layout_window(GRect area) {
+  int width = s_window_bounds.size.w;
+  int canvas_h = s_window_bounds.size.h * 0.4;
+  bool show_info = area.size.h >= canvas_h + INFO_TOP + INFO_HEIGHT;
+  if (!show_info && (area.size.h - (DATE_TOP + DATE_HEIGHT) < canvas_h)) {
+    canvas_h = area.size.h - (DATE_TOP + DATE_HEIGHT);
+    if (canvas_h < MIN_CANVAS_HEIGHT) canvas_h = MIN_CANVAS_HEIGHT;
+  }
+  int text_top = area.origin.y + canvas_h;
+  GRect canvas = GRect(0, area.origin.y, width, canvas_h);
+  layer_set_frame(s_canvas_layer, canvas);
+  layer_set_frame(text_layer_get_layer(s_time_layer), GRect(0, text_top, width, TIME_HEIGHT));
+  layer_set_frame(text_layer_get_layer(s_date_layer), GRect(0, text_top + DATE_TOP, width, DATE_HEIGHT));
+  layer_set_frame(text_layer_get_layer(s_info_layer), GRect(0, text_top + INFO_TOP, width, INFO_HEIGHT));
+  layer_set_hidden(text_layer_get_layer(s_info_layer), !show_info);
+  return canvas;
+}
+
+// fit the graph to the canvas; the paths and sprites are projected again
+// with show_sky_paths()
+static void fit_graph(GRect canvas) {
+  sky_graph_set_bounds(canvas, s_window_bounds);
+  s_projected_h = canvas.size.h;
+  s_y_scale = SKY_PATH_SCALE_ONE;
+}
+
+#if defined(SKY_PROFILE) && !defined(PBL_PLATFORM_APLITE)
+static void report_peek_frames() {
+  if (s_peek_frames > 0) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Quick View moved in %d frames, %d ms on average, %d ms at most",
+            s_peek_frames, s_peek_frame_ms / s_peek_frames, s_peek_frame_ms_max);
+  }
+  s_peek_frames = 0;
+  s_peek_frame_ms = 0;
+  s_peek_frame_ms_max = 0;
+}
+#endif
+
+#ifndef PBL_PLATFORM_APLITE
+static void unobstructed_will_change(GRect final_area, void *context) {
+#ifdef SKY_PROFILE
+  s_peek_moving = true;
+#endif
+}
+
+static void unobstructed_change(AnimationProgress progress, void *context) {
+  // the layers follow the peek; the graph is only scaled, and on round
+  // displays left as it is
+#ifdef PBL_ROUND
+  layout_window(unobstructed_area(window_get_root_layer(s_main_window)));
+#else
+  GRect canvas = layout_window(unobstructed_area(window_get_root_layer(s_main_window)));
+  s_y_scale = canvas.size.h * SKY_PATH_SCALE_ONE / s_projected_h;
+#endif
+  layer_mark_dirty(s_canvas_layer);
+}
+
+static void unobstructed_did_change(void *context) {
+#ifdef SKY_PROFILE
+  s_peek_moving = false;
+#endif
+  fit_graph(layout_window(unobstructed_area(window_get_root_layer(s_main_window))));
+  show_sky_paths();
+#ifdef SKY_PROFILE
+  report_peek_frames();
+#endif
+}
+#endif
+
+// the paths, planets, sun and moon, as the sky state has placed them
+static void draw_sky(GContext *ctx) {
+  // Draw the solar and lunar paths
+  sky_path_draw(ctx, &s_solar_path, s_y_scale);
+  sky_path_draw(ctx, &s_lunar_path, s_y_scale);
+
+  // the planets that are up, under the sun and moon
+  int k;
+  for (k=0;k<SKY_PLANETS;k++) {
+    if (!s_sky.planet_up[k]) continue;
+    graphics_context_set_fill_color(ctx, planet_color(k));
+    graphics_fill_circle(ctx, sky_path_scaled(s_sky.planets[k], s_y_scale), 1);
+  }
+  graphics_context_set_fill_color(ctx, GColorWhite);
+  
+  // Draw the sun and moon where the sky state has placed them, their
+  // centres scaled with the rest while a peek moves
+  GPoint sun = sky_path_scaled(GPoint(s_sky.sun.x + 7, s_sky.sun.y + 6), s_y_scale);
+  GRect bitmap_placed = GRect(sun.x - 7,sun.y - 6,15,13);
+  graphics_draw_bitmap_in_rect(ctx, s_bitmap_sun, bitmap_placed);
+
+  GPoint moon = sky_path_scaled(GPoint(s_sky.moon.x + 6, s_sky.moon.y + 6), s_y_scale);
+  GRect bitmap_moon_placed = GRect(moon.x - 6,moon.y - 6,13,13);
+  // Draw the moon, timing it in profiling builds
+#ifdef SKY_PROFILE
+  time_t moon_start_s;
+  uint16_t moon_start_ms;
+  time_ms(&moon_start_s, &moon_start_ms);
+#endif
+#ifdef MOON_PHASE_BITMAPS
+  graphics_draw_bitmap_in_rect(ctx, s_bitmap_moon, bitmap_moon_placed);
+#else
+  moon_render_draw(ctx, bitmap_moon_placed.origin);
+#endif
+#ifdef SKY_PROFILE
+  s_moon_draw_ms += ms_since(moon_start_s, moon_start_ms);
+  s_moon_draws++;
+#endif
 }
 
 static void canvas_update_proc(Layer *layer, GContext *ctx) {
   // Custom drawing happens here!
-  int i;
-  GPoint point1, point2;
+#ifdef SKY_PROFILE
+  time_t frame_start_s;
+  uint16_t frame_start_ms;
+  time_ms(&frame_start_s, &frame_start_ms);
+#endif
+  PROFILE_START(frame);
+
+#ifdef SKY_PATHS_EVERY_FRAME
+  s_sky_paths_stale = true;
+#endif
+  if (s_sky_paths_stale && s_sky.placed) project_sky_paths();
   
   // Disable antialiasing (enabled by default where available)
   // graphics_context_set_antialiased(ctx, false);
@@ -372,71 +1009,100 @@ static void canvas_update_proc(Layer *layer, GContext *ctx) {
   graphics_context_set_compositing_mode(ctx, GCompOpSet);
   
   // Generate the horizon 
-  GRect horizon_box = GRect(hour_to_xpixel(0),angle_to_ypixel(0),hour_to_xpixel(24),7);
+  GPoint horizon_start = sky_path_scaled(sky_graph_point(0, 0), s_y_scale);
+  GPoint horizon_end = sky_graph_point(360, 0);
+  GRect horizon_box = GRect(horizon_start.x,horizon_start.y,horizon_end.x-horizon_start.x,7);
   // Draw the horizon box
   graphics_draw_bitmap_in_rect(ctx, s_bitmap_horizon, horizon_box);
 
-  // Draw solar path
-  for (i=0;i<24;i++) {
-    point1 = GPoint(hour_to_xpixel(i),angle_to_ypixel(solar_elev[i]));
-    point2 = GPoint(hour_to_xpixel(i+1),angle_to_ypixel(solar_elev[i+1]));
-    if ((solar_elev[i]>0)||(solar_elev[i+1]>0) ) graphics_draw_line(ctx, point1, point2);
-  }
-  // Draw lunar path
-  float curr_azi;
-  for (i=0;i<24;i++) {
-    curr_azi = lunar_azi[i] - solar_azi[0];
-    if (curr_azi > 360) curr_azi = curr_azi - 360;
-    if (curr_azi < 0 ) curr_azi = curr_azi + 360; 
-    point1 = GPoint(hour_to_xpixel(curr_azi/15),angle_to_ypixel(lunar_elev[i]));
-    point2 = GPoint(hour_to_xpixel(curr_azi/15+1),angle_to_ypixel(lunar_elev[i+1]));
-    if ((lunar_elev[i]>0)||(lunar_elev[i+1]>0)) graphics_draw_line(ctx, point1, point2);
+  // the paths, planets, sun and moon, once there is a day to place them on
+  if (s_sky.placed) draw_sky(ctx);
+
+#ifdef SKY_PROFILE
+  int frame_ms = ms_since(frame_start_s, frame_start_ms);
+  s_frame_ms += frame_ms;
+  if (frame_ms > s_frame_ms_max) s_frame_ms_max = frame_ms;
+  s_frames++;
+  if (s_peek_moving) {
+    s_peek_frame_ms += frame_ms;
+    if (frame_ms > s_peek_frame_ms_max) s_peek_frame_ms_max = frame_ms;
+    s_peek_frames++;
+    PROFILE_END(frame, SKY_PROFILE_PEEK_FRAME);
   }
-  
-  // Calculate sun position
-  // Get a tm structure
-  time_t temp = time(NULL);
-  struct tm *curr_time = localtime(&temp);
-  int hour = curr_time->tm_hour;  
-  float frac_hour = ((float)curr_time->tm_min)/60;
-  curr_solar_elev = solar_elev[hour] + frac_hour * (solar_elev[hour+1]-solar_elev[hour]);
-  curr_solar_azi = solar_azi[hour] + 15 * frac_hour;
-  curr_solar_azi = fmod_pebble(curr_solar_azi,360);
-  float curr_elev = curr_solar_elev;
- 
-  // If sun is too low, stop lowering its position
-  if (curr_elev < -7) curr_elev = -7;
-  // Get the location to place the sun
-  GRect bitmap_placed = GRect(hour_to_xpixel(hour+frac_hour)-7,angle_to_ypixel(curr_elev)-6,15,13);
-  // Draw the image
-  graphics_draw_bitmap_in_rect(ctx, s_bitmap_sun, bitmap_placed);
+  else {
+    PROFILE_END(frame, SKY_PROFILE_FRAME);
+  }
+  PROFILE_COUNT(SKY_PROFILE_FRAMES);
 
+  if (!s_first_frame_drawn) {
+    s_first_frame_drawn = true;
+    APP_LOG(APP_LOG_LEVEL_INFO, "Launch to first frame took %d ms", ms_since(s_launch_s, s_launch_ms));
+  }
+#endif
+}
 
-  curr_lunar_elev = lunar_elev[hour] + frac_hour * (lunar_elev[hour+1]-lunar_elev[hour]);
-  curr_lunar_azi = lunar_azi[hour] + 15 * frac_hour;  
-  curr_lunar_azi = fmod_pebble(curr_lunar_azi,360);
-  curr_elev = curr_lunar_elev;
+//
+// Preview
+//
+// A tap steps the graph on a day at a time, then to the next full moon and
+// back to now; with no tap for a while it goes back to now by itself.  The
+// day after the one shown is fetched in the background (see sky_preview.h),
+// so a tap only swaps its tables in and redraws.
+//
 
-  APP_LOG(APP_LOG_LEVEL_DEBUG, "Azi offset %d", (int)fmod_pebble(solar_azi[0],360));
+#define PREVIEW_TIMEOUT_MS 8000
 
-  curr_azi = lunar_azi[hour] + frac_hour * 15 - solar_azi[0];  // for display purposes
-  curr_azi = fmod_pebble(curr_azi,360);
-  // If moon is too low, stop lowering its position
-  if (curr_elev < -7) curr_elev = -7;
-  // Get the location to place the moon
-  GRect bitmap_moon_placed = GRect(hour_to_xpixel(curr_azi/15)-6,angle_to_ypixel(curr_elev)-6,13,13);
-  // Draw the image
-  graphics_draw_bitmap_in_rect(ctx, s_bitmap_moon, bitmap_moon_placed);
+static AppTimer *s_preview_timer;
+
+static void show_preview(SkyPreviewStep step) {
+  s_preview_step = step;
+  if (step == SKY_PREVIEW_NOW) {
+    s_preview = NULL;
+    load_moon_image();
+  }
+  else {
+    s_preview = sky_preview_show(step, settings.Latitude, settings.Longitude);
+    show_moon(s_preview->lunar_day, s_preview->moon_fraction, s_preview->moon_zenith_angle);
+  }
+  show_sky_paths();
+  update_texts();
+  // ready for the next tap; from now that is tomorrow
+  SkyPreviewStep next = sky_preview_next(step);
+  sky_preview_prefetch((next == SKY_PREVIEW_NOW) ? SKY_PREVIEW_TOMORROW : next,
+                       settings.Latitude, settings.Longitude);
+}
 
+static void preview_timeout(void *data) {
+  s_preview_timer = NULL;
+  show_preview(SKY_PREVIEW_NOW);
+}
+
+static void cancel_preview_timeout() {
+  if (s_preview_timer) app_timer_cancel(s_preview_timer);
+  s_preview_timer = NULL;
+}
+
+static void accel_tap_handler(AccelAxisType axis, int32_t direction) {
+  cancel_preview_timeout();
+  show_preview(sky_preview_next(s_preview_step));
+  if (s_preview) s_preview_timer = app_timer_register(PREVIEW_TIMEOUT_MS, preview_timeout, NULL);
+}
+
+// back to now without waiting, as the tables or the location are changing
+static void end_preview() {
+  cancel_preview_timeout();
+  if (s_preview) show_preview(SKY_PREVIEW_NOW);
 }
 
 // code to get settings from phone via pebble-clay
 
 // Initialize the default settings
 static void prv_default_settings() {
-  settings.Latitude = 64.8;
-  settings.Longitude = -147;
+  settings.Latitude = DEFAULT_LATITUDE;
+  settings.Longitude = DEFAULT_LONGITUDE;
   settings.ShowInfo = true;
+  settings.PhoneEphemeris = false;
+  settings.BackgroundWorker = false;
 }
 
 // Save the settings to persistent storage
@@ -451,38 +1117,181 @@ static void prv_load_settings() {
   persist_read_data(SETTINGS_KEY, &settings, sizeof(settings));
 }
 
-static void prv_inbox_received_handler(DictionaryIterator *iter, void *context) {
-  // Read lat / lon and other
+// Location updates
+//
+// A location from the settings page is always taken.  A GPS fix (sent with
+// LocationFix) only counts as a move if it would change a rise or set time
+// in the info text by a minute: a quarter of a degree of longitude, or a
+// change of latitude that turns the sun's, twilight's or moon's hour angle
+// at the horizon by a quarter of a degree (a minute of time).  Smaller
+// moves, like fixes wandering around one spot, keep the tables (and the
+// cached days) for where we were.
+//
+// The table recomputes and why they happened are counted over each day.
+
+static void report_recomputes() {
+  APP_LOG(APP_LOG_LEVEL_INFO, "Recomputes in the day: %d for location moves (%d updates too small to show), %d day tables calculated",
+          s_location_moves, s_location_ignored, s_days_calculated);
+  s_location_moves = 0;
+  s_location_ignored = 0;
+  s_days_calculated = 0;
+}
+
+#define MINUTE_OF_ARC_DEGREES 0.25f   // the sky turns this far in a minute
+
+// cos of the hour angle at which a body at declination dec (radians)
+// crosses altitude h0 (degrees) from latitude lat (degrees); outside -1..1
+// when it doesn't cross it
+static float crossing_cos_hour_angle(float lat, float dec, float h0) {
+  float phi = lat * rad;
+  return (sin_pebble(h0 * rad) - sin_pebble(phi) * sin_pebble(dec)) / (cos_pebble(phi) * cos_pebble(dec));
+}
+
+// true if moving to latitude turns the crossing's hour angle by a minute,
+// or starts or stops it crossing; compared in cos, as dH = d(cos H) / sin H
+static bool crossing_moved(float latitude, float dec, float h0) {
+  float from = crossing_cos_hour_angle(settings.Latitude, dec, h0);
+  float to = crossing_cos_hour_angle(latitude, dec, h0);
+  bool crosses_from = (from > -1) && (from < 1);
+  bool crosses_to = (to > -1) && (to < 1);
+  if (crosses_from != crosses_to) return true;
+  if (!crosses_from) return false;
+  float minute = MINUTE_OF_ARC_DEGREES * rad;
+  return (to - from) * (to - from) >= minute * minute * (1 - from * from);
+}
+
+static bool location_moved(float latitude, float longitude, bool gps_fix) {
+  float lat_change = latitude - settings.Latitude;
+  float lng_change = longitude - settings.Longitude;
+  if (lat_change < 0) lat_change = -lat_change;
+  if (lng_change < 0) lng_change = -lng_change;
+  if (lng_change > 180) lng_change = 360 - lng_change;
+  if ((lat_change == 0) && (lng_change == 0)) return false;
+
+  if (gps_fix && (lng_change < MINUTE_OF_ARC_DEGREES)) {
+    // today's declinations; the moon rises and sets at about +0.13 degrees
+    float d = toDays(time(NULL));
+    float sun_dec, sun_ra, moon_ra, moon_dec;
+    sunCoords(d, &sun_dec, &sun_ra);
+    moonCoords(d, &moon_ra, &moon_dec);
+    if (!crossing_moved(latitude, sun_dec, -0.833f) && !crossing_moved(latitude, sun_dec, -6) &&
+        !crossing_moved(latitude, moon_dec, 0.133f)) {
+      s_location_ignored++;
+      return false;
+    }
+  }
+  s_location_moves++;
+  PROFILE_COUNT(SKY_PROFILE_LOCATION_MOVES);
+  return true;
+}
+
+static void read_inbox(DictionaryIterator *iter) {
+  // sky path tables from the phone, and the phone saying it is ready for requests
+  if (dict_find(iter, MESSAGE_KEY_SkyChunk)) {
+    receive_phone_tables(iter);
+    return;
+  }
+  if (dict_find(iter, MESSAGE_KEY_SkyPhoneReady)) {
+    request_phone_tables();
+    return;
+  }
+
+  // Read lat / lon and other, in hundredths of a degree, from the settings
+  // page or the phone's GPS; both together are one move
+  float latitude = settings.Latitude;
+  float longitude = settings.Longitude;
   Tuple *latitude_t = dict_find(iter, MESSAGE_KEY_Latitude);
   if(latitude_t) {
-    settings.Latitude = (float)(latitude_t->value->int32);
-    redo_sky_paths();
+    latitude = latitude_t->value->int32 / 100.0f;
   }
-
   Tuple *longitude_t = dict_find(iter, MESSAGE_KEY_Longitude);
   if(longitude_t) {
-    settings.Longitude = (float)(longitude_t->value->int32);
+    longitude = longitude_t->value->int32 / 100.0f;
+  }
+  // a place that can't exist is a unit mix-up on the phone; keep where we are
+  if ((latitude < -90) || (latitude > 90) || (longitude < -180) || (longitude > 180)) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Ignoring location %d, %d (hundredths of a degree)",
+            latitude_t ? (int)latitude_t->value->int32 : 0, longitude_t ? (int)longitude_t->value->int32 : 0);
+    latitude = settings.Latitude;
+    longitude = settings.Longitude;
+  }
+  // cached sky paths are only thrown away when the location really changes
+  bool location_changed = location_moved(latitude, longitude, dict_find(iter, MESSAGE_KEY_LocationFix) != NULL);
+  if (location_changed) {
+    end_preview();
+    settings.Latitude = latitude;
+    settings.Longitude = longitude;
+    cancel_recompute();
+    sky_cache_invalidate();
+    sky_store_clear();
     redo_sky_paths();
+    schedule_precompute();
+    sky_preview_prefetch(SKY_PREVIEW_TOMORROW, settings.Latitude, settings.Longitude);
   }
 
   // Read boolean preferences
+  bool settings_changed = location_changed;
   Tuple *show_info_t = dict_find(iter, MESSAGE_KEY_ShowInfo);
-  if(show_info_t) {
+  if(show_info_t && (settings.ShowInfo != (show_info_t->value->int32 == 1))) {
     settings.ShowInfo = show_info_t->value->int32 == 1;
+    settings_changed = true;
+  }
+  Tuple *phone_ephemeris_t = dict_find(iter, MESSAGE_KEY_PhoneEphemeris);
+  if(phone_ephemeris_t && (settings.PhoneEphemeris != (phone_ephemeris_t->value->int32 == 1))) {
+    settings.PhoneEphemeris = phone_ephemeris_t->value->int32 == 1;
+    settings_changed = true;
   }
+  Tuple *background_worker_t = dict_find(iter, MESSAGE_KEY_BackgroundWorker);
+  if(background_worker_t && (settings.BackgroundWorker != (background_worker_t->value->int32 == 1))) {
+    settings.BackgroundWorker = background_worker_t->value->int32 == 1;
+    settings_changed = true;
+    update_worker();
+    // without the worker the face precomputes the coming days itself
+    if (!settings.BackgroundWorker) schedule_precompute();
+  }
+  // a GPS fix that didn't move us, or the settings saved as they were, costs
+  // no persist write and no request
+  if (!settings_changed) return;
   prv_save_settings();
+
+  // the worker re-reads the saved settings and fills the cache for them
+  if (location_changed && app_worker_is_running()) {
+    AppWorkerMessage message = { 0 };
+    app_worker_send_message(WORKER_MSG_LOCATION_CHANGED, &message);
+  }
+  // and the phone, if it is to, sends tables for anything not cached yet
+  request_phone_tables();
+}
+
+static void prv_inbox_received_handler(DictionaryIterator *iter, void *context) {
+  PROFILE_START(inbox);
+  read_inbox(iter);
+  PROFILE_END(inbox, SKY_PROFILE_INBOX);
+}
+
+// The outbox callbacks are global, so they are registered once here for
+// everything the face sends.  A phone request that isn't delivered needs
+// nothing more, as the recompute is already scheduled behind it; a profile
+// dump goes on to its next message.
+static void prv_outbox_sent_handler(DictionaryIterator *iter, void *context) {
+  PROFILE_OUTBOX_SENT(iter);
+}
+
+static void prv_outbox_failed_handler(DictionaryIterator *iter, AppMessageResult reason, void *context) {
+  if (dict_find(iter, MESSAGE_KEY_SkyRequest)) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Sky tables request not delivered, reason %d", (int)reason);
+  }
+  PROFILE_OUTBOX_FAILED(iter, reason);
 }
 
 static void main_window_load(Window *window) {
   // Get information about the Window
   Layer *window_layer = window_get_root_layer(window);
-  GRect bounds = layer_get_bounds(window_layer);
+  s_window_bounds = layer_get_bounds(window_layer);
 
-  // create drawing canvas for data visualization -- top 40% of display
-  s_canvas_layer = layer_create(
-      GRect(0, 0, bounds.size.w, bounds.size.h*0.4));
-  graph_width = bounds.size.w;
-  graph_height = bounds.size.h*0.4;
+  // create drawing canvas for data visualization -- top 40% of display,
+  // placed with the text by layout_window() below
+  s_canvas_layer = layer_create(GRectZero);
   
   // Assign the custom drawing procedure
   layer_set_update_proc(s_canvas_layer, canvas_update_proc);
@@ -491,8 +1300,7 @@ static void main_window_load(Window *window) {
   layer_add_child(window_get_root_layer(window), s_canvas_layer);
   
   // Create the TextLayer with specific bounds on bottom half of display
-  s_time_layer = text_layer_create(
-      GRect(0, bounds.size.h*0.4, bounds.size.w, 43));
+  s_time_layer = text_layer_create(GRectZero);
   
   // Improve the layout to be more like a watchface
   text_layer_set_background_color(s_time_layer, GColorBlack);
@@ -504,8 +1312,7 @@ static void main_window_load(Window *window) {
   layer_add_child(window_layer, text_layer_get_layer(s_time_layer));
   
   // Create date information layer
-  s_date_layer = text_layer_create(
-    GRect(0, (bounds.size.h*0.4+43), bounds.size.w, 26));
+  s_date_layer = text_layer_create(GRectZero);
 
   // Style the text
   text_layer_set_background_color(s_date_layer, GColorBlack);
@@ -518,8 +1325,7 @@ static void main_window_load(Window *window) {
   layer_add_child(window_layer, text_layer_get_layer(s_date_layer));
 
   // Create info layer
-  s_info_layer = text_layer_create(
-    GRect(0, (bounds.size.h*0.4+70), bounds.size.w, 26));
+  s_info_layer = text_layer_create(GRectZero);
 
   // Style the text
   text_layer_set_background_color(s_info_layer, GColorBlack);
@@ -531,9 +1337,17 @@ static void main_window_load(Window *window) {
   // Add it as a child layer to the Window's root layer
   layer_add_child(window_layer, text_layer_get_layer(s_info_layer));
 
+  // lay it all out for the screen as any peek leaves it, and fit the graph
+  fit_graph(layout_window(unobstructed_area(window_layer)));
+  invalidate_sky_paths();
 }
 
 static void main_window_unload(Window *window) {
+  // Stop any pending recompute or preview, they would draw to the canvas
+  cancel_recompute();
+  cancel_preview_timeout();
+  sky_preview_cancel();
+
   // Destroy TextLayers
   text_layer_destroy(s_time_layer);
   text_layer_destroy(s_date_layer);
@@ -542,19 +1356,48 @@ static void main_window_unload(Window *window) {
   // Destroy canvas
   layer_destroy(s_canvas_layer);
   
-  // Destroy the image data
-  gbitmap_destroy(s_bitmap_sun);
-  gbitmap_destroy(s_bitmap_horizon);
-  gbitmap_destroy(s_bitmap_moon);
+  // Give the images back to the cache, which destroys them
+  bitmap_cache_release(s_bitmap_sun);
+  bitmap_cache_release(s_bitmap_horizon);
+#ifdef MOON_PHASE_BITMAPS
+  bitmap_cache_release(s_bitmap_moon);
+  s_bitmap_moon = NULL;
+#endif
+  s_bitmap_sun = s_bitmap_horizon = NULL;
+  APP_LOG(APP_LOG_LEVEL_INFO, "Bitmap cache: %d bytes live after unload, %d bytes at peak",
+          bitmap_cache_live_bytes(), bitmap_cache_peak_bytes());
 }
 
 static void init() {
+  // note the launch time, to report how long the first frame takes
+#ifdef SKY_PROFILE
+  time_ms(&s_launch_s, &s_launch_ms);
+#endif
+
   prv_load_settings();
+
+  // room for the sun and moon tracks, a day of them if the full horizon
+  // doesn't fit
+  time_t today = local_midnight(time(NULL));
+  if (!sky_store_create(SKY_HORIZON_HOURS, today)) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "No room for %d hours of sky paths, keeping 24", SKY_HORIZON_HOURS);
+    if (!sky_store_create(24, today)) {
+      // the store stays empty, so the sky isn't placed and only the time shows
+      APP_LOG(APP_LOG_LEVEL_ERROR, "No room for the sky paths");
+    }
+  }
   
   // Open AppMessage connection
   app_message_register_inbox_received(prv_inbox_received_handler);
+  app_message_register_outbox_sent(prv_outbox_sent_handler);
+  app_message_register_outbox_failed(prv_outbox_failed_handler);
   app_message_open(128, 128);
 
+  // Start the background worker that precomputes the sky paths, if the
+  // settings ask for it
+  app_worker_message_subscribe(worker_message_handler);
+  update_worker();
+
   // Create main Window element and assign to pointer
   s_main_window = window_create();
 
@@ -577,21 +1420,40 @@ static void init() {
   window_set_background_color(s_main_window, GColorBlack);
   
   // load bitmaps
-  s_bitmap_horizon = gbitmap_create_with_resource(RESOURCE_ID_IMAGE_HORIZON);
+  s_bitmap_horizon = bitmap_cache_acquire(RESOURCE_ID_IMAGE_HORIZON);
   
-  // calculate sun paths
+  // calculate sun paths, or read them from the cache
+  sky_cache_evict(today);
   redo_sky_paths();
 
-  // get proper moon phase image
+  // get proper moon phase image; the sun (set/risen) image is picked with
+  // the sky state
   load_moon_image();
 
-  // get proper sun (set/risen) image
-  load_sun_image();
+  // fill the cache for the coming days in the background, and have
+  // tomorrow ready for a tap
+  schedule_precompute();
+  sky_preview_prefetch(SKY_PREVIEW_TOMORROW, settings.Latitude, settings.Longitude);
+  accel_tap_service_subscribe(accel_tap_handler);
+#ifndef PBL_PLATFORM_APLITE
+  unobstructed_area_service_subscribe((UnobstructedAreaHandlers) {
+    .will_change = unobstructed_will_change,
+    .change = unobstructed_change,
+    .did_change = unobstructed_did_change
+  }, NULL);
+#endif
 }
 
 static void deinit() {
+  accel_tap_service_unsubscribe();
+#ifndef PBL_PLATFORM_APLITE
+  unobstructed_area_service_unsubscribe();
+#endif
+
   // Destroy Window
   window_destroy(s_main_window);
+
+  sky_store_destroy();
 }
 
 int main(void) {
@@ -0,0 +1,97 @@
+#include "moon_render.h"
+#include "ephemeris.h"
+
+// a row bit per pixel, bit x for column x
+static uint16_t s_disc[MOON_SIZE];
+static uint16_t s_lit[MOON_SIZE];
+static float s_fraction = -1;   // what the mask was built for, -1 before the first
+static float s_zenith_angle;
+
+// Half a pixel of terminator movement is a fraction change of 1 / MOON_SIZE,
+// and half a pixel at the horns is an angle change of 1 / MOON_SIZE radians
+#define MOON_FRACTION_STEP (1.0f / MOON_SIZE)
+#define MOON_ANGLE_STEP (1.0f / MOON_SIZE)
+
+static void build_mask(float fraction, float zenith_angle) {
+  // direction of the sun across the disc, screen y pointing down
+  float sun_x = -sin_pebble(zenith_angle);
+  float sun_y = -cos_pebble(zenith_angle);
+  // the terminator is the half ellipse u = k * sqrt(1 - v * v) across the
+  // disc, with u along the sun direction and v across it
+  float k = 1 - 2 * fraction;
+  float radius = MOON_SIZE / 2.0f;
+  int px, py;
+
+  for (py=0;py<MOON_SIZE;py++) {
+    s_disc[py] = 0;
+    s_lit[py] = 0;
+    for (px=0;px<MOON_SIZE;px++) {
+      float x = (px - (MOON_SIZE - 1) / 2.0f) / radius;
+      float y = (py - (MOON_SIZE - 1) / 2.0f) / radius;
+      if (x * x + y * y > 1) continue;
+      s_disc[py] |= 1 << px;
+
+      float u = x * sun_x + y * sun_y;
+      float v = y * sun_x - x * sun_y;
+      // u > k * sqrt(1 - v * v), squared out so no square root is needed
+      float limit = k * k * (1 - v * v);
+      bool lit = (k >= 0) ? ((u > 0) && (u * u > limit)) : ((u >= 0) || (u * u < limit));
+      if (lit) s_lit[py] |= 1 << px;
+    }
+  }
+}
+
+static float angle_difference(float a, float b) {
+  float d = fmod_pebble(a - b + pi, 2 * pi) - pi;
+  return d < 0 ? -d : d;
+}
+
+bool moon_render_update(float fraction, float zenith_angle) {
+  float fraction_change = fraction - s_fraction;
+  if (fraction_change < 0) fraction_change = -fraction_change;
+  if ((s_fraction >= 0) && (fraction_change < MOON_FRACTION_STEP) &&
+      (angle_difference(zenith_angle, s_zenith_angle) < MOON_ANGLE_STEP)) {
+    return false;
+  }
+  build_mask(fraction, zenith_angle);
+  s_fraction = fraction;
+  s_zenith_angle = zenith_angle;
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Moon mask rebuilt, %d%% lit", (int)(fraction * 100));
+  return true;
+}
+
+// draw each run of set bits in the rows as a line
+static void draw_rows(GContext *ctx, GPoint origin, const uint16_t rows[]) {
+  int px, py, start;
+  for (py=0;py<MOON_SIZE;py++) {
+    start = -1;
+    for (px=0;px<=MOON_SIZE;px++) {
+      bool set = (px < MOON_SIZE) && (rows[py] & (1 << px));
+      if (set && (start < 0)) start = px;
+      if (!set && (start >= 0)) {
+        graphics_draw_line(ctx, GPoint(origin.x + start, origin.y + py), GPoint(origin.x + px - 1, origin.y + py));
+        start = -1;
+      }
+    }
+  }
+}
+
+void moon_render_draw(GContext *ctx, GPoint origin) {
+  // the dark side faintly where there is colour, else just its outline
+#ifdef PBL_COLOR
+  uint16_t dark[MOON_SIZE];
+  int py;
+  for (py=0;py<MOON_SIZE;py++) dark[py] = s_disc[py] & ~s_lit[py];
+  graphics_context_set_stroke_color(ctx, GColorDarkGray);
+  draw_rows(ctx, origin, dark);
+#else
+  graphics_context_set_stroke_color(ctx, GColorWhite);
+  graphics_draw_circle(ctx, GPoint(origin.x + MOON_SIZE / 2, origin.y + MOON_SIZE / 2), MOON_SIZE / 2);
+#endif
+  graphics_context_set_stroke_color(ctx, GColorWhite);
+  draw_rows(ctx, origin, s_lit);
+}
+
+int moon_render_bytes() {
+  return sizeof(s_disc) + sizeof(s_lit);
+}
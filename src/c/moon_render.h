@@ -0,0 +1,22 @@
+#pragma once
+#include <pebble.h>
+//
+// Procedural moon
+//
+// The moon is drawn from its illuminated fraction and bright limb angle
+// (moonIllumination) instead of one of nine phase bitmaps.  The disc is
+// worked out pixel by pixel into a small mask of row bits, which is only
+// rebuilt when the phase or the limb angle has moved by enough to change a
+// pixel; drawing runs along the mask's rows.
+//
+
+#define MOON_SIZE 13   // pixels across, the size of the old moon bitmaps
+
+// rebuild the mask if the moon now looks different; true if it was rebuilt
+bool moon_render_update(float fraction, float zenith_angle);
+
+// draw the moon with its top left corner at origin
+void moon_render_draw(GContext *ctx, GPoint origin);
+
+// memory the mask takes
+int moon_render_bytes();
@@ -0,0 +1,20 @@
+#pragma once
+//
+// Watchface settings, shared with the background worker
+//
+
+// Persistent storage key
+#define SETTINGS_KEY 1
+
+// Fairbanks, Alaska
+#define DEFAULT_LATITUDE 64.8
+#define DEFAULT_LONGITUDE -147
+
+// Define our settings struct
+typedef struct ClaySettings {
+  float Latitude;
+  float Longitude;
+  bool ShowInfo;
+  bool PhoneEphemeris;  // ask the phone for the sky paths, see sky_phone.h
+  bool BackgroundWorker;  // precompute in the background worker, see skypath_worker.h
+} ClaySettings;
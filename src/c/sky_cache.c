@@ -0,0 +1,106 @@
+#include "sky_cache.h"
+
+typedef struct SkyCacheHeader {
+  int32_t day;      // local midnight, unix time
+  int16_t lat;      // hundredths of a degree
+  int16_t lng;
+  uint8_t version;
+} SkyCacheHeader;
+
+typedef struct SkyCacheEntry {
+  SkyCacheHeader header;
+  SkyCacheTracks tracks;
+} SkyCacheEntry;
+
+_Static_assert(sizeof(SkyCacheEntry) <= PERSIST_DATA_MAX_LENGTH, "sky cache entry must fit one persist value");
+
+// kept off the stack, which is small on the watch
+static SkyCacheEntry s_entry;
+
+static int32_t to_centidegrees(float degrees) {
+  return (int32_t)(degrees * 100 + (degrees < 0 ? -0.5f : 0.5f));
+}
+
+static bool read_header(int slot, SkyCacheHeader *header) {
+  if (persist_read_data(SKY_CACHE_KEY + slot, header, sizeof(SkyCacheHeader)) != (int)sizeof(SkyCacheHeader)) {
+    return false;
+  }
+  return header->version == SKY_CACHE_VERSION;
+}
+
+// slot holding this day and location, or -1
+static int find_slot(time_t day, float lat, float lng) {
+  SkyCacheHeader header;
+  int slot;
+  for (slot=0;slot<SKY_CACHE_DAYS;slot++) {
+    if (read_header(slot, &header) && (header.day == day) &&
+        (header.lat == to_centidegrees(lat)) && (header.lng == to_centidegrees(lng))) {
+      return slot;
+    }
+  }
+  return -1;
+}
+
+bool sky_cache_contains(time_t day, float lat, float lng) {
+  return find_slot(day, lat, lng) >= 0;
+}
+
+const SkyCacheTracks *sky_cache_read(time_t day, float lat, float lng) {
+  int slot = find_slot(day, lat, lng);
+  if (slot < 0) return NULL;
+  if (persist_read_data(SKY_CACHE_KEY + slot, &s_entry, sizeof(s_entry)) != (int)sizeof(s_entry)) return NULL;
+  return &s_entry.tracks;
+}
+
+void sky_cache_pack(SkyCacheTracks *tracks, const float solar_elev[], const float solar_azi[], const float lunar_elev[], const float lunar_azi[]) {
+  int i;
+  for (i=0;i<25;i++) {
+    tracks->solar_elev[i] = to_centidegrees(solar_elev[i]);
+    tracks->solar_azi[i] = (uint16_t)to_centidegrees(solar_azi[i]);
+    tracks->lunar_elev[i] = to_centidegrees(lunar_elev[i]);
+    tracks->lunar_azi[i] = (uint16_t)to_centidegrees(lunar_azi[i]);
+  }
+}
+
+void sky_cache_store(time_t day, float lat, float lng, const float solar_elev[], const float solar_azi[], const float lunar_elev[], const float lunar_azi[]) {
+  SkyCacheHeader header;
+  int slot, oldest_slot = 0;
+  int32_t oldest_day = INT32_MAX;
+
+  // reuse this day's slot, else an empty or foreign slot, else the oldest day
+  slot = find_slot(day, lat, lng);
+  if (slot < 0) {
+    for (slot=0;slot<SKY_CACHE_DAYS;slot++) {
+      if (!read_header(slot, &header) || (header.lat != to_centidegrees(lat)) || (header.lng != to_centidegrees(lng))) break;
+      if (header.day < oldest_day) {
+        oldest_day = header.day;
+        oldest_slot = slot;
+      }
+    }
+    if (slot == SKY_CACHE_DAYS) slot = oldest_slot;
+  }
+
+  s_entry.header.day = day;
+  s_entry.header.lat = to_centidegrees(lat);
+  s_entry.header.lng = to_centidegrees(lng);
+  s_entry.header.version = SKY_CACHE_VERSION;
+  sky_cache_pack(&s_entry.tracks, solar_elev, solar_azi, lunar_elev, lunar_azi);
+  persist_write_data(SKY_CACHE_KEY + slot, &s_entry, sizeof(s_entry));
+}
+
+void sky_cache_evict(time_t today) {
+  SkyCacheHeader header;
+  int slot;
+  for (slot=0;slot<SKY_CACHE_DAYS;slot++) {
+    if (read_header(slot, &header) && (header.day < today)) {
+      persist_delete(SKY_CACHE_KEY + slot);
+    }
+  }
+}
+
+void sky_cache_invalidate() {
+  int slot;
+  for (slot=0;slot<SKY_CACHE_DAYS;slot++) {
+    persist_delete(SKY_CACHE_KEY + slot);
+  }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#ifdef SKYPATH_WORKER
+#include <pebble_worker.h>
+#else
+#include <pebble.h>
+#endif
+//
+// Persistent cache of precomputed daily sky path tables
+//
+// Each entry holds one local day's 25 hourly samples of the four tables,
+// keyed by the day's local midnight and the location it was computed for.
+// Samples are stored as hundredths of a degree so a whole day fits in a
+// single persist value.  Startup and the midnight rollover read the day from
+// here instead of recomputing it.
+//
+
+// hours of sky path the face keeps in RAM (sky_store.h): 24, 48 or 168
+#ifndef SKY_HORIZON_HOURS
+#define SKY_HORIZON_HOURS 24
+#endif
+#define SKY_HORIZON_DAYS (SKY_HORIZON_HOURS / 24)
+
+#define SKY_CACHE_VERSION 2   // 2: elevations from the arcsine table
+#define SKY_CACHE_KEY 10    // persist keys SKY_CACHE_KEY .. SKY_CACHE_KEY + SKY_CACHE_DAYS - 1
+#define SKY_CACHE_DAYS (SKY_HORIZON_DAYS + 2)  // the horizon and the next two days
+
+// one day's samples in hundredths of a degree, as they are cached
+typedef struct SkyCacheTracks {
+  int16_t solar_elev[25];
+  uint16_t solar_azi[25];   // azimuths are 0..36000 so unsigned
+  int16_t lunar_elev[25];
+  uint16_t lunar_azi[25];
+} SkyCacheTracks;
+
+// the day's samples as cached, or NULL; only good until the next call in here
+const SkyCacheTracks *sky_cache_read(time_t day, float lat, float lng);
+
+bool sky_cache_contains(time_t day, float lat, float lng);
+
+// round float degree tables into the cached form
+void sky_cache_pack(SkyCacheTracks *tracks, const float solar_elev[], const float solar_azi[], const float lunar_elev[], const float lunar_azi[]);
+
+void sky_cache_store(time_t day, float lat, float lng, const float solar_elev[], const float solar_azi[], const float lunar_elev[], const float lunar_azi[]);
+
+// drop entries for days before today
+void sky_cache_evict(time_t today);
+
+// drop everything, for a change of location
+void sky_cache_invalidate();
@@ -0,0 +1,156 @@
+#include "sky_events.h"
+
+#define REFINE_ITERATIONS 4   // position calls at most per crossing
+#define REFINE_SECS 30        // stop once the crossing is bracketed this closely
+#define PEAK_STEP_SECS 600    // spacing of the points the maximum is refined on
+
+static int s_evaluations;
+
+// elevation of the sun or moon in degrees, from the engine the tables use
+static float body_elev(bool moon, time_t when, float lat, float lng) {
+  s_evaluations++;
+#ifdef EPHEMERIS_FIXED_POINT
+  int32_t azi, alt;
+  int32_t lat_angle = (int32_t)(lat * TRIG_MAX_ANGLE / 360);
+  int32_t lng_angle = (int32_t)(lng * TRIG_MAX_ANGLE / 360);
+  if (moon) moonPositionFixed(when, lat_angle, lng_angle, &azi, &alt);
+  else sunPositionFixed(when, lat_angle, lng_angle, &azi, &alt);
+  return (float)alt * 360 / TRIG_MAX_ANGLE;
+#else
+  float azi, alt;
+  if (moon) moonPosition(when, lat, lng, &azi, &alt);
+  else sunPosition(when, lat, lng, &azi, &alt);
+  return alt * deg_conv;
+#endif
+}
+
+// the time elev crosses horizon between t0 and t1, where it is above by a0
+// and a1 (one of them negative); regula falsi, with the Illinois change so
+// the end that stays put is pulled in too
+static time_t refine_crossing(bool moon, float lat, float lng, float horizon,
+                              time_t t0, float a0, time_t t1, float a1) {
+  int i;
+  time_t t = t0;
+  int kept = 0;             // which end stayed put last time, -1 or 1
+  float w0 = a0, w1 = a1;   // the ends as the next step weighs them
+  for (i=0;i<REFINE_ITERATIONS;i++) {
+    t = t0 + (time_t)((t1 - t0) * w0 / (w0 - w1));
+    if ((t1 - t0 <= REFINE_SECS) || (t <= t0) || (t >= t1)) break;
+    float a = body_elev(moon, t, lat, lng) - horizon;
+    if ((a < 0) == (a0 < 0)) {
+      t0 = t;
+      a0 = w0 = a;
+      if (kept == 1) w1 /= 2;
+      kept = 1;
+    }
+    else {
+      t1 = t;
+      a1 = w1 = a;
+      if (kept == -1) w0 /= 2;
+      kept = -1;
+    }
+  }
+  // the last bracket, by the elevations themselves, is the closest
+  if ((t1 > t0) && (a0 != a1)) t = t0 + (time_t)((t1 - t0) * a0 / (a0 - a1));
+  return t;
+}
+
+// offset of the vertex of the parabola through (-1, e0), (0, e1), (1, e2),
+// kept within -1..1, and the value there
+static float parabola_vertex(float e0, float e1, float e2, float *vertex) {
+  float curve = e0 - 2 * e1 + e2;
+  float x = (curve != 0) ? (e0 - e2) / (2 * curve) : 0;
+  if (x < -1) x = -1;
+  if (x > 1) x = 1;
+  *vertex = e1 + x * (e2 - e0) / 2 + x * x * curve / 2;
+  return x;
+}
+
+// keep a crossing between t0 and t1, where the body is above horizon by a0
+// and a1, if it is the first of its kind
+static void add_crossing(SkyCrossings *crossings, bool moon, float lat, float lng, float horizon,
+                         time_t t0, float a0, time_t t1, float a1) {
+  if ((a0 < 0) && (a1 >= 0) && !crossings->rise) {
+    crossings->rise = refine_crossing(moon, lat, lng, horizon, t0, a0, t1, a1);
+  }
+  if ((a0 >= 0) && (a1 < 0) && !crossings->set) {
+    crossings->set = refine_crossing(moon, lat, lng, horizon, t0, a0, t1, a1);
+  }
+}
+
+// first rise and set across horizon in the hourly samples
+static void solve_crossings(SkyCrossings *crossings, bool moon, time_t day_start, float lat, float lng,
+                            const float elev[], float horizon) {
+  int h;
+  crossings->rise = 0;
+  crossings->set = 0;
+  for (h=0;h<24;h++) {
+    float a0 = elev[h] - horizon;
+    float a1 = elev[h+1] - horizon;
+    time_t t0 = day_start + h * 3600;
+
+    // near the poles a body can graze the horizon, crossing it and back
+    // between samples: where the samples turn close to it, look at the turn
+    if ((h > 0) && ((elev[h-1] - horizon < 0) == (a0 < 0)) && ((a0 < 0) == (a1 < 0)) &&
+        ((elev[h] - elev[h-1]) * (elev[h+1] - elev[h]) <= 0)) {
+      float vertex;
+      float x = parabola_vertex(elev[h-1], elev[h], elev[h+1], &vertex);
+      if ((vertex - horizon < 0) != (a0 < 0)) {
+        time_t turn = t0 + (time_t)(x * 3600);
+        float a = body_elev(moon, turn, lat, lng) - horizon;
+        if ((a < 0) != (a0 < 0)) {
+          if (x < 0) {
+            add_crossing(crossings, moon, lat, lng, horizon, t0 - 3600, elev[h-1] - horizon, turn, a);
+            add_crossing(crossings, moon, lat, lng, horizon, turn, a, t0, a0);
+          }
+          else {
+            add_crossing(crossings, moon, lat, lng, horizon, t0, a0, turn, a);
+            add_crossing(crossings, moon, lat, lng, horizon, turn, a, t0 + 3600, a1);
+          }
+        }
+      }
+    }
+    add_crossing(crossings, moon, lat, lng, horizon, t0, a0, t0 + 3600, a1);
+  }
+  if (crossings->rise || crossings->set) crossings->all_day = SKY_CROSSES;
+  else crossings->all_day = (elev[0] >= horizon) ? SKY_UP_ALL_DAY : SKY_DOWN_ALL_DAY;
+}
+
+// the highest point in the day: an hourly sample at least as high as the
+// ones either side of it (the hour before and after the day count at its
+// ends), refined; 0 if there is none during the day
+static time_t solve_transit(bool moon, time_t day_start, float lat, float lng, const float elev[], int8_t *transit_elev) {
+  int h;
+  float before, after, peak;
+  for (h=0;h<=24;h++) {
+    before = (h > 0) ? elev[h-1] : body_elev(moon, day_start - 3600, lat, lng);
+    if (elev[h] < before) continue;
+    after = (h < 24) ? elev[h+1] : body_elev(moon, day_start + 25 * 3600, lat, lng);
+    if (elev[h] <= after) continue;
+
+    // the parabola through the hours gets it to within minutes; three
+    // points around its peak then pin it down
+    time_t t = day_start + h * 3600 + (time_t)(parabola_vertex(before, elev[h], after, &peak) * 3600);
+    t += (time_t)(parabola_vertex(body_elev(moon, t - PEAK_STEP_SECS, lat, lng),
+                                body_elev(moon, t, lat, lng),
+                                body_elev(moon, t + PEAK_STEP_SECS, lat, lng), &peak) * PEAK_STEP_SECS);
+    if ((t >= day_start) && (t < day_start + 24 * 3600)) {
+      *transit_elev = (int8_t)peak;
+      return t;
+    }
+  }
+  *transit_elev = 0;
+  return 0;
+}
+
+void sky_events_solve(SkyEvents *events, time_t day_start, float lat, float lng,
+                      const float solar_elev[], const float lunar_elev[]) {
+  s_evaluations = 0;
+  events->day = day_start;
+  solve_crossings(&events->sun, false, day_start, lat, lng, solar_elev, SKY_SUN_HORIZON);
+  solve_crossings(&events->civil, false, day_start, lat, lng, solar_elev, SKY_CIVIL_TWILIGHT);
+  solve_crossings(&events->moon, true, day_start, lat, lng, lunar_elev, SKY_MOON_HORIZON);
+  events->solar_noon = solve_transit(false, day_start, lat, lng, solar_elev, &events->solar_noon_elev);
+  events->lunar_transit = solve_transit(true, day_start, lat, lng, lunar_elev, &events->lunar_transit_elev);
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "Sky events solved with %d position calls", s_evaluations);
+}
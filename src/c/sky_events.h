@@ -0,0 +1,47 @@
+#pragma once
+#include "ephemeris.h"
+//
+// Rise, set and transit times
+//
+// Worked out from a day's hourly elevation samples: a horizon crossing or a
+// maximum is bracketed between samples, then refined with a few calls to
+// sunPosition/moonPosition (regula falsi for crossings, a parabola through
+// three points for maxima) instead of scanning the day minute by minute.
+//
+// Near the poles a body can stay up or down all day; then there are no
+// crossings, and all_day says which.  Only the first rise and set of each
+// kind in the day are kept.
+//
+
+// elevations the crossings are taken at, degrees: the sun's upper limb with
+// refraction, the centre of the moon allowing for parallax, and civil twilight
+#define SKY_SUN_HORIZON -0.833f
+#define SKY_MOON_HORIZON 0.125f
+#define SKY_CIVIL_TWILIGHT -6.0f
+
+typedef enum {
+  SKY_CROSSES,        // rises or sets (or both) during the day
+  SKY_UP_ALL_DAY,
+  SKY_DOWN_ALL_DAY
+} SkyAllDay;
+
+typedef struct SkyCrossings {
+  time_t rise, set;   // 0 if it doesn't cross that way during the day
+  uint8_t all_day;    // SkyAllDay
+} SkyCrossings;
+
+typedef struct SkyEvents {
+  time_t day;                   // local midnight the events are for
+  SkyCrossings sun;
+  SkyCrossings civil;           // rise is dawn, set is dusk
+  SkyCrossings moon;
+  time_t solar_noon;            // highest points, 0 if not during the day
+  time_t lunar_transit;
+  int8_t solar_noon_elev;       // degrees
+  int8_t lunar_transit_elev;
+} SkyEvents;
+
+// solve the day starting at day_start, from its 25 hourly elevation samples
+// in degrees (as sky_paths_hours writes them)
+void sky_events_solve(SkyEvents *events, time_t day_start, float lat, float lng,
+                      const float solar_elev[], const float lunar_elev[]);
@@ -0,0 +1,92 @@
+#include "sky_graph.h"
+
+#define ACROSS_STEPS 360        // one entry per degree across
+#define ELEV_MIN -90
+#define ELEV_PER_DEGREE 2       // near the pole a degree of elevation is more than a pixel
+#define ELEV_STEPS (180 * ELEV_PER_DEGREE + 1)
+#define MAX_ROWS 128            // tallest canvas, emery's 40% is 91 rows
+#define ROUND_INSET 8           // rows nearer the top of a round display than this keep its chord
+
+static int16_t s_x[ACROSS_STEPS + 1];   // pixel, or on round displays the offset from the middle in 1/256ths of half the width
+static int16_t s_y[ELEV_STEPS];
+#ifdef PBL_ROUND
+static int16_t s_half_width[MAX_ROWS];  // half the display's width along each row
+#endif
+
+static GRect s_canvas, s_display;
+static float s_lat = -1000;             // latitude the y table is for
+static int s_y_range, s_y_top;          // degrees the graph covers, and the top of it
+
+static void build_x_table() {
+  int i;
+  for (i=0;i<=ACROSS_STEPS;i++) {
+#ifdef PBL_ROUND
+    s_x[i] = (int16_t)((i * 512 + ACROSS_STEPS / 2) / ACROSS_STEPS - 256);
+#else
+    s_x[i] = (int16_t)(i * s_canvas.size.w / ACROSS_STEPS);
+#endif
+  }
+#ifdef PBL_ROUND
+  // the display's circle, by Newton's square root of each row's chord.  At
+  // the very top the chord shrinks to nothing and would pile the points on
+  // the middle column, so rows above ROUND_INSET are as wide as that one
+  int radius = s_display.size.w / 2;
+  int centre_y = s_display.origin.y + s_display.size.h / 2 - s_canvas.origin.y;
+  int min_chord2 = 2 * radius * ROUND_INSET - ROUND_INSET * ROUND_INSET;
+  for (i=0;(i<s_canvas.size.h)&&(i<MAX_ROWS);i++) {
+    int dy = i - centre_y;
+    int chord2 = radius * radius - dy * dy;
+    int half = radius;
+    int j;
+    if (chord2 < min_chord2) chord2 = min_chord2;
+    for (j=0;j<8;j++) half = (half + chord2 / half) / 2;
+    s_half_width[i] = half;
+  }
+#endif
+}
+
+static void build_y_table() {
+  int i;
+  // set y scale based upon latitude
+  s_y_range = (90 - s_lat + 23.5) * 1.35;  // full graph 135% of the potential range at that lat
+  if (s_y_range>110) s_y_range = 110;
+  s_y_top = (90 - s_lat + 23.5) * 1.05;  // this gives a 20% buffer below the horizon.
+  if (s_y_top>90) s_y_top = 90;
+  for (i=0;i<ELEV_STEPS;i++) {
+    s_y[i] = (int16_t)((s_y_top * ELEV_PER_DEGREE - (ELEV_MIN * ELEV_PER_DEGREE + i)) * s_canvas.size.h / (s_y_range * ELEV_PER_DEGREE));
+  }
+}
+
+void sky_graph_set_bounds(GRect canvas, GRect display) {
+  s_canvas = canvas;
+  s_display = display;
+  build_x_table();
+  if (s_lat > -1000) build_y_table();
+}
+
+void sky_graph_set_latitude(float lat) {
+  if (lat == s_lat) return;
+  s_lat = lat;
+  build_y_table();
+}
+
+// nearest table entry, clamped to the table
+static int table_index(float value, int offset, int steps) {
+  int i = (int)(value - offset + 0.5f);
+  if (i < 0) i = 0;
+  if (i > steps - 1) i = steps - 1;
+  return i;
+}
+
+GPoint sky_graph_point(float across, float elev) {
+  int y = s_y[table_index(elev * ELEV_PER_DEGREE, ELEV_MIN * ELEV_PER_DEGREE, ELEV_STEPS)];
+  int x = s_x[table_index(across, 0, ACROSS_STEPS + 1)];
+#ifdef PBL_ROUND
+  int row = y;
+  if (row < 0) row = 0;
+  if (row > s_canvas.size.h - 1) row = s_canvas.size.h - 1;
+  if (row > MAX_ROWS - 1) row = MAX_ROWS - 1;
+  x = s_canvas.size.w / 2 + x * s_half_width[row] / 256;
+#endif
+  return GPoint(x, y);
+}
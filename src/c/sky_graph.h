@@ -0,0 +1,23 @@
+#pragma once
+#include <pebble.h>
+//
+// Projection of the sky onto the graph
+//
+// Across the graph is the time of day, or for the moon and planets their
+// azimuth from the sun's at midnight, as degrees 0..360; up it is elevation,
+// on a scale set from the latitude.  Both are worked out into integer tables
+// when the canvas is laid out or the latitude changes, an entry per degree
+// across and per half degree up, so placing a point is a table lookup.
+//
+// On round displays (chalk) the graph is fitted inside the circle: each row
+// is narrowed to the width of the display there, so the ends of the day
+// curve in with the bezel rather than running off the screen.
+//
+
+// the canvas, and the display it is on
+void sky_graph_set_bounds(GRect canvas, GRect display);
+// the y scale follows the latitude; tables are only rebuilt if it moved
+void sky_graph_set_latitude(float lat);
+
+// the point for degrees across (0..360) and elevation (degrees)
+GPoint sky_graph_point(float across, float elev);
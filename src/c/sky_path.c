@@ -0,0 +1,144 @@
+#include "sky_path.h"
+#include "sky_graph.h"
+
+// the hourly samples of the path being built, and how many steps each hour
+// is split into
+static float s_across[25];
+static float s_elev[25];
+static GPoint s_knots[25];
+static int s_steps[24];
+
+// the last point added, and the horizon and edge points put in so far
+static float s_last_across, s_last_elev;
+static int s_crossings;
+static int s_edges;
+
+// across jumps the edge of the graph, where the path isn't drawn
+static bool wraps(float a, float b) {
+  return (b - a > 180) || (a - b > 180);
+}
+
+// how far the hourly point i is off the middle of the points either side,
+// in pixels: the second difference of the projected path
+static int bend(int i) {
+  if ((i <= 0) || (i >= 24)) return 0;
+  if (wraps(s_across[i-1], s_across[i]) || wraps(s_across[i], s_across[i+1])) return 0;
+  int dx = s_knots[i-1].x - 2 * s_knots[i].x + s_knots[i+1].x;
+  int dy = s_knots[i-1].y - 2 * s_knots[i].y + s_knots[i+1].y;
+  if (dx < 0) dx = -dx;
+  if (dy < 0) dy = -dy;
+  return (dx > dy) ? dx : dy;
+}
+
+// the elevation halfway through hour h, as the track's spline has it from
+// the samples either side (straight across at the ends)
+static float midpoint_elev(int h) {
+  if ((h == 0) || (h == 23)) return (s_elev[h] + s_elev[h+1]) / 2;
+  return (9 * (s_elev[h] + s_elev[h+1]) - s_elev[h-1] - s_elev[h+2]) / 16;
+}
+
+// the fewest steps for hour h that keep the curve within the tolerance of
+// its chords; a curve bending by d off its chord strays d/8 over the step,
+// and a quarter of that for each halving of the step
+static int steps_for(int h) {
+  if (wraps(s_across[h], s_across[h+1])) return 1;
+  int n = 1;
+  if ((s_elev[h] <= 0) && (s_elev[h+1] <= 0)) {
+    // a moon only grazing the horizon can be up between two hours it isn't
+    if (midpoint_elev(h) <= 0) return 1;
+    n = 2;
+  }
+  int b0 = bend(h), b1 = bend(h+1);
+  float error = ((b0 > b1) ? b0 : b1) / 8.0f;
+  while ((n < SKY_PATH_MAX_SPLIT) && (error > SKY_PATH_TOLERANCE_PX * n * n)) n++;
+  return n;
+}
+
+// split the hours, then take steps back off the most split hours until the
+// points added fit
+static int plan_steps() {
+  int h, added = 0;
+  for (h=0;h<24;h++) {
+    s_steps[h] = steps_for(h);
+    added += s_steps[h] - 1;
+  }
+  while (added > SKY_PATH_SPLIT_POINTS) {
+    int most = 0;
+    for (h=1;h<24;h++) {
+      if (s_steps[h] > s_steps[most]) most = h;
+    }
+    s_steps[most]--;
+    added--;
+  }
+  return added;
+}
+
+static void append(SkyPath *path, GPoint point, bool drawn) {
+  if (path->count > 0) path->drawn[path->count-1] = drawn;
+  path->points[path->count++] = point;
+}
+
+static void add_point(SkyPath *path, float across, float elev, GPoint point) {
+  if (path->count > 0) {
+    // off one edge of the graph and on at the other: a point at each edge,
+    // so the path runs right up to them
+    if (wraps(s_last_across, across) && (s_edges < SKY_PATH_EDGES)) {
+      float edge = (across < s_last_across) ? 360 : 0;
+      float unwrapped = (across < s_last_across) ? across + 360 : across - 360;
+      float edge_elev = s_last_elev + (elev - s_last_elev) * (edge - s_last_across) / (unwrapped - s_last_across);
+      s_edges++;
+      add_point(path, edge, edge_elev, sky_graph_point(edge, edge_elev));
+      s_last_across = 360 - edge;
+      append(path, sky_graph_point(s_last_across, edge_elev), false);
+    }
+    bool wrap = wraps(s_last_across, across);
+    // a point on the horizon where the path crosses it
+    if (!wrap && (s_crossings < SKY_PATH_CROSSINGS) &&
+        (((s_last_elev > 0) && (elev < 0)) || ((s_last_elev < 0) && (elev > 0)))) {
+      float t = s_last_elev / (s_last_elev - elev);
+      append(path, sky_graph_point(s_last_across + t * (across - s_last_across), 0), s_last_elev > 0);
+      s_last_elev = 0;
+      s_crossings++;
+    }
+    append(path, point, !wrap && ((s_last_elev > 0) || (elev > 0)));
+  }
+  else {
+    append(path, point, false);
+  }
+  s_last_across = across;
+  s_last_elev = elev;
+}
+
+int sky_path_build(SkyPath *path, SkyPathEval eval) {
+  int h, i;
+  for (h=0;h<=24;h++) {
+    eval(h, &s_across[h], &s_elev[h]);
+    s_knots[h] = sky_graph_point(s_across[h], s_elev[h]);
+  }
+  int added = plan_steps();
+
+  path->count = 0;
+  s_crossings = 0;
+  s_edges = 0;
+  for (h=0;h<=24;h++) {
+    add_point(path, s_across[h], s_elev[h], s_knots[h]);
+    if (h == 24) break;
+    for (i=1;i<s_steps[h];i++) {
+      float across, elev;
+      eval(h + (float)i / s_steps[h], &across, &elev);
+      add_point(path, across, elev, sky_graph_point(across, elev));
+    }
+  }
+  return 25 + added;
+}
+
+void sky_path_draw(GContext *ctx, const SkyPath *path, int32_t y_scale) {
+  int i;
+  if (path->count < 2) return;
+  GPoint from = sky_path_scaled(path->points[0], y_scale);
+  for (i=0;i<path->count-1;i++) {
+    GPoint to = sky_path_scaled(path->points[i+1], y_scale);
+    if (path->drawn[i]) graphics_draw_line(ctx, from, to);
+    from = to;
+  }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <pebble.h>
+//
+// Sky paths as polylines on the graph
+//
+// A path starts from its track at each hour, the samples the tracks are
+// fitted through, projected with sky_graph_point.  Hours where the path
+// bends on screen are then split into shorter steps: the bend is read off
+// the projected hourly points (their second difference), so deciding
+// costs no evaluations, and an hour gets the fewest equal steps that keep
+// the curve within SKY_PATH_TOLERANCE_PX of its chords.  Hours below the
+// horizon aren't drawn and aren't split, unless the spline comes up between
+// their samples.  The points splitting adds to a path are capped at
+// SKY_PATH_SPLIT_POINTS, so it never takes more evaluations than the fixed
+// half-hourly sampling did, and the sharpest bends are cut back last.
+//
+// Where a path crosses the horizon a point is put in on it, at 0 degrees,
+// so the drawn part ends at the horizon rather than at a sample below it.
+// The moon's path runs off one side of the graph and on at the other; it
+// gets a point at each edge in the same way.
+//
+// Drawing takes a y scale, so a path can be drawn on a canvas whose height
+// has changed since it was built (as a Quick View peek slides in) without
+// building it again; the graph's y tables are linear in the height.  Only
+// y is scaled, which is exact on rectangular displays; on round ones x
+// depends on the row as well (sky_graph.h), so they don't scale paths.
+//
+
+#define SKY_PATH_TOLERANCE_PX 0.5f
+#define SKY_PATH_MAX_SPLIT 4          // steps an hour is split into at most
+#define SKY_PATH_SPLIT_POINTS 24      // points added by splitting, over a whole path
+#define SKY_PATH_CROSSINGS 6          // horizon points a path can take
+#define SKY_PATH_EDGES 2              // times a path can run off the edge of the graph
+#define SKY_PATH_MAX_POINTS (25 + SKY_PATH_SPLIT_POINTS + SKY_PATH_CROSSINGS + 2 * SKY_PATH_EDGES)
+#define SKY_PATH_SCALE_ONE 256        // y scale for the height the path was built at
+
+typedef struct SkyPath {
+  int count;
+  GPoint points[SKY_PATH_MAX_POINTS];
+  bool drawn[SKY_PATH_MAX_POINTS - 1];    // segment from points[i] to points[i+1]
+} SkyPath;
+
+// a path's position at hour (0..24): degrees across (0..360) and elevation
+typedef void (*SkyPathEval)(float hour, float *across, float *elev);
+
+// fill path from eval; returns the evaluations it took
+int sky_path_build(SkyPath *path, SkyPathEval eval);
+
+// a projected point at y_scale/SKY_PATH_SCALE_ONE of the height it was projected for
+static inline GPoint sky_path_scaled(GPoint point, int32_t y_scale) {
+  return GPoint(point.x, point.y * y_scale / SKY_PATH_SCALE_ONE);
+}
+
+void sky_path_draw(GContext *ctx, const SkyPath *path, int32_t y_scale);
@@ -0,0 +1,130 @@
+#include "sky_phone.h"
+
+// the day being put together, chunk by chunk
+static uint8_t s_day_bytes[SKY_PHONE_DAY_BYTES];
+static int s_day_length;
+static time_t s_day;
+static int32_t s_day_lat, s_day_lng;   // hundredths of a degree
+static uint8_t s_chunks_received;      // bit per chunk
+static uint8_t s_chunk_count;
+
+// transfer totals since launch, reported as each day completes
+static int s_bytes_received;
+static int s_messages_received;
+
+// read position while decoding
+static int s_decode_pos;
+
+static int32_t to_centidegrees(float degrees) {
+  return (int32_t)(degrees * 100 + (degrees < 0 ? -0.5f : 0.5f));
+}
+
+bool sky_phone_request(time_t today, int days, float lat, float lng) {
+  DictionaryIterator *iter;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) return false;
+  dict_write_int32(iter, MESSAGE_KEY_SkyRequest, (int32_t)today);
+  dict_write_int32(iter, MESSAGE_KEY_SkyDays, days);
+  dict_write_int32(iter, MESSAGE_KEY_SkyLatitude, to_centidegrees(lat));
+  dict_write_int32(iter, MESSAGE_KEY_SkyLongitude, to_centidegrees(lng));
+  return app_message_outbox_send() == APP_MSG_OK;
+}
+
+bool sky_phone_receive(DictionaryIterator *iter, float lat, float lng, time_t *day) {
+  Tuple *day_t = dict_find(iter, MESSAGE_KEY_SkyDay);
+  Tuple *lat_t = dict_find(iter, MESSAGE_KEY_SkyLatitude);
+  Tuple *lng_t = dict_find(iter, MESSAGE_KEY_SkyLongitude);
+  Tuple *index_t = dict_find(iter, MESSAGE_KEY_SkyChunkIndex);
+  Tuple *count_t = dict_find(iter, MESSAGE_KEY_SkyChunkCount);
+  Tuple *chunk_t = dict_find(iter, MESSAGE_KEY_SkyChunk);
+  if (!day_t || !lat_t || !lng_t || !index_t || !count_t || !chunk_t) return false;
+
+  int index = index_t->value->int32;
+  int count = count_t->value->int32;
+  int length = chunk_t->length;
+  if ((count < 1) || (count * SKY_PHONE_CHUNK_BYTES > SKY_PHONE_DAY_BYTES + SKY_PHONE_CHUNK_BYTES - 1) ||
+      (index < 0) || (index >= count) || (length > SKY_PHONE_CHUNK_BYTES) ||
+      (index * SKY_PHONE_CHUNK_BYTES + length > SKY_PHONE_DAY_BYTES)) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Bad sky table chunk %d of %d, %d bytes", index, count, length);
+    return false;
+  }
+  s_bytes_received += length;
+  s_messages_received++;
+
+  // a chunk of a different day starts over
+  if ((day_t->value->int32 != s_day) || (lat_t->value->int32 != s_day_lat) ||
+      (lng_t->value->int32 != s_day_lng) || (count != s_chunk_count)) {
+    s_day = day_t->value->int32;
+    s_day_lat = lat_t->value->int32;
+    s_day_lng = lng_t->value->int32;
+    s_chunk_count = count;
+    s_chunks_received = 0;
+    s_day_length = 0;
+  }
+  memcpy(&s_day_bytes[index * SKY_PHONE_CHUNK_BYTES], chunk_t->value->data, length);
+  s_chunks_received |= 1 << index;
+  if (index == count - 1) s_day_length = index * SKY_PHONE_CHUNK_BYTES + length;
+  if (s_chunks_received != (1 << count) - 1) return false;
+
+  // tables for a location the watch has since moved away from are no use
+  if ((s_day_lat != to_centidegrees(lat)) || (s_day_lng != to_centidegrees(lng))) {
+    s_chunks_received = 0;
+    return false;
+  }
+  *day = s_day;
+  return true;
+}
+
+// next zigzag varint, or false if the day runs out first
+static bool read_varint(int32_t *value) {
+  uint32_t zigzag = 0;
+  int shift = 0;
+  uint8_t byte;
+  do {
+    if ((s_decode_pos >= s_day_length) || (shift > 28)) return false;
+    byte = s_day_bytes[s_decode_pos++];
+    zigzag |= (uint32_t)(byte & 0x7f) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  *value = (zigzag & 1) ? -(int32_t)(zigzag >> 1) - 1 : (int32_t)(zigzag >> 1);
+  return true;
+}
+
+// the first sample, then second differences; azimuths wrap round 0..36000
+static bool decode_track(float track[], bool wrap360) {
+  int32_t value, delta = 0, change;
+  int i;
+  if (!read_varint(&value)) return false;
+  track[0] = value / 100.0f;
+  for (i=1;i<25;i++) {
+    if (!read_varint(&change)) return false;
+    delta += change;
+    value += delta;
+    if (wrap360) {
+      if (value >= 36000) value -= 36000;
+      if (value < 0) value += 36000;
+    }
+    track[i] = value / 100.0f;
+  }
+  return true;
+}
+
+bool sky_phone_decode(float solar_elev[], float solar_azi[], float lunar_elev[], float lunar_azi[]) {
+  time_t start_s, end_s;
+  uint16_t start_ms, end_ms;
+  time_ms(&start_s, &start_ms);
+
+  s_decode_pos = 0;
+  bool ok = decode_track(solar_elev, false) && decode_track(solar_azi, true) &&
+            decode_track(lunar_elev, false) && decode_track(lunar_azi, true);
+  s_chunks_received = 0;
+
+  time_ms(&end_s, &end_ms);
+  int decode_ms = (int)(end_s - start_s) * 1000 + end_ms - start_ms;
+  if (!ok) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Sky tables from the phone ended early, %d bytes", s_day_length);
+    return false;
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO, "Sky tables from the phone: %d bytes this day, %d bytes in %d messages so far, decoded in %d ms",
+          s_day_length, s_bytes_received, s_messages_received, decode_ms);
+  return true;
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <pebble.h>
+//
+// Sky path tables calculated on the phone
+//
+// With the PhoneEphemeris setting on, the face asks PebbleKit JS for the
+// coming days' tables (src/pkjs/sky_tables.js).  They arrive as packed,
+// delta-encoded chunks of a day at a time and are decoded here straight into
+// the float tables, which then go into the persistent cache like any other
+// day.  Whatever the phone doesn't deliver is still calculated on the watch.
+//
+
+#define SKY_PHONE_CHUNK_BYTES 64   // matches CHUNK_BYTES in sky_tables.js
+#define SKY_PHONE_DAY_BYTES 300    // four tracks of 25 samples, at most 3 bytes each
+
+// ask the phone for the days from today's local midnight on
+bool sky_phone_request(time_t today, int days, float lat, float lng);
+
+// take in a chunk from an inbox message; true once it completes a day
+// calculated for this location
+bool sky_phone_receive(DictionaryIterator *iter, float lat, float lng, time_t *day);
+
+// decode the day just completed into the tables
+bool sky_phone_decode(float solar_elev[], float solar_azi[], float lunar_elev[], float lunar_azi[]);
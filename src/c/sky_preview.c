@@ -0,0 +1,177 @@
+#include "sky_preview.h"
+#include "ephemeris.h"
+
+#define PREFETCH_DELAY_MS 100         // start once the tap's frame is drawn
+#define PREFETCH_STEP_GAP_MS 50       // pause between steps to let the event loop run
+#define PREFETCH_HOURS_PER_STEP 5     // hourly samples calculated per timer callback
+#define FULL_MOON_SEARCH_DAYS 31
+
+typedef enum {
+  FETCH_IDLE,
+  FETCH_PENDING,        // to be started by the timer
+  FETCH_CALCULATING,    // hourly samples from s_fetch_hour on still to do
+  FETCH_DONE
+} FetchState;
+
+// the day shown and the day being fetched, with where they are for
+static SkyPreviewDay s_days[2];
+static float s_day_lat[2], s_day_lng[2];
+static int s_shown;   // index in s_days; the fetch goes into the other
+
+static FetchState s_fetch_state = FETCH_IDLE;
+static SkyPreviewStep s_fetch_step;
+static int s_fetch_hour;
+static AppTimer *s_fetch_timer;
+
+// staging tables for a day being calculated
+static float s_solar_elev[25];
+static float s_solar_azi[25];
+static float s_lunar_elev[25];
+static float s_lunar_azi[25];
+
+// the last full moon search, as it takes a month of illuminations
+static time_t s_full_moon_from;
+static time_t s_full_moon_day;
+
+SkyPreviewStep sky_preview_next(SkyPreviewStep step) {
+  return (step + 1 < SKY_PREVIEW_STEPS) ? step + 1 : SKY_PREVIEW_NOW;
+}
+
+// the first day from tomorrow whose midday is at least as lit as the
+// middays either side of it
+static time_t full_moon_day(time_t today, float lat, float lng) {
+  float before, fraction, after, zenith_angle;
+  int i;
+  if (s_full_moon_from == today) return s_full_moon_day;
+  moonIllumination(today + 12 * 3600, lat, lng, &before, &zenith_angle);
+  moonIllumination(today + 36 * 3600, lat, lng, &fraction, &zenith_angle);
+  for (i=1;i<FULL_MOON_SEARCH_DAYS;i++) {
+    moonIllumination(today + (i + 1) * 86400 + 12 * 3600, lat, lng, &after, &zenith_angle);
+    if ((fraction >= before) && (fraction >= after)) break;
+    before = fraction;
+    fraction = after;
+  }
+  s_full_moon_from = today;
+  s_full_moon_day = local_midnight(today + i * 86400 + 12 * 3600);
+  return s_full_moon_day;
+}
+
+// local midnight of the day step shows
+static time_t step_day(SkyPreviewStep step, float lat, float lng) {
+  time_t today = local_midnight(time(NULL));
+  if (step == SKY_PREVIEW_FULL_MOON) return full_moon_day(today, lat, lng);
+  // midday of the day step days on, so daylight saving changes don't matter
+  return local_midnight(today + step * 86400 + 12 * 3600);
+}
+
+// the day's first sample from the end of the day before, if that is the
+// day shown or today in the store; true if it was there
+static bool take_first_sample(time_t day, float lat, float lng) {
+  const SkyPreviewDay *shown = &s_days[s_shown];
+  if ((shown->day + 24 * 3600 == day) && (s_day_lat[s_shown] == lat) && (s_day_lng[s_shown] == lng)) {
+    s_solar_elev[0] = shown->tracks.solar_elev[24] / 100.0f;
+    s_solar_azi[0] = shown->tracks.solar_azi[24] / 100.0f;
+    s_lunar_elev[0] = shown->tracks.lunar_elev[24] / 100.0f;
+    s_lunar_azi[0] = shown->tracks.lunar_azi[24] / 100.0f;
+    return true;
+  }
+  if ((sky_store_start() + 24 * 3600 == day) && sky_store_contains(sky_store_start())) {
+    s_solar_elev[0] = sky_store_eval(SKY_SOLAR_ELEV, 24);
+    s_solar_azi[0] = sky_store_eval(SKY_SOLAR_AZI, 24);
+    s_lunar_elev[0] = sky_store_eval(SKY_LUNAR_ELEV, 24);
+    s_lunar_azi[0] = sky_store_eval(SKY_LUNAR_AZI, 24);
+    return true;
+  }
+  return false;
+}
+
+static void begin_fetch(float lat, float lng) {
+  int i = 1 - s_shown;
+  SkyPreviewDay *fetch = &s_days[i];
+  fetch->day = step_day(s_fetch_step, lat, lng);
+  s_day_lat[i] = lat;
+  s_day_lng[i] = lng;
+
+  // the moon as it will be at this time of day
+  time_t now = time(NULL);
+  time_t when = fetch->day + (now - local_midnight(now));
+  fetch->lunar_day = moonPhase(when);
+  moonIllumination(when, lat, lng, &fetch->moon_fraction, &fetch->moon_zenith_angle);
+
+  const SkyCacheTracks *cached = sky_cache_read(fetch->day, lat, lng);
+  if (cached) {
+    fetch->tracks = *cached;
+    s_fetch_state = FETCH_DONE;
+    return;
+  }
+  s_fetch_hour = take_first_sample(fetch->day, lat, lng) ? 1 : 0;
+  s_fetch_state = FETCH_CALCULATING;
+}
+
+static void calculate_hours(int hours, float lat, float lng) {
+  SkyPreviewDay *fetch = &s_days[1 - s_shown];
+  int last = s_fetch_hour + hours - 1;
+  if (last > 24) last = 24;
+  sky_paths_hours(fetch->day, s_fetch_hour, last, lat, lng, s_solar_elev, s_solar_azi, s_lunar_elev, s_lunar_azi);
+  s_fetch_hour = last + 1;
+  if (s_fetch_hour > 24) {
+    sky_cache_pack(&fetch->tracks, s_solar_elev, s_solar_azi, s_lunar_elev, s_lunar_azi);
+    // and keep it, so the precompute doesn't work the day out again; a full
+    // moon past the cached days would only push one of them out
+    if (fetch->day < local_midnight(time(NULL)) + SKY_CACHE_DAYS * 86400) {
+      sky_cache_store(fetch->day, lat, lng, s_solar_elev, s_solar_azi, s_lunar_elev, s_lunar_azi);
+    }
+    s_fetch_state = FETCH_DONE;
+  }
+}
+
+static void fetch_step(void *data) {
+  int i = 1 - s_shown;
+  s_fetch_timer = NULL;
+  if (s_fetch_state == FETCH_PENDING) begin_fetch(s_day_lat[i], s_day_lng[i]);
+  else if (s_fetch_state == FETCH_CALCULATING) calculate_hours(PREFETCH_HOURS_PER_STEP, s_day_lat[i], s_day_lng[i]);
+  if ((s_fetch_state == FETCH_PENDING) || (s_fetch_state == FETCH_CALCULATING)) {
+    s_fetch_timer = app_timer_register(PREFETCH_STEP_GAP_MS, fetch_step, NULL);
+  }
+}
+
+// true if the fetch is for step's day at this place (done or not)
+static bool fetching(SkyPreviewStep step, float lat, float lng) {
+  int i = 1 - s_shown;
+  if ((s_fetch_state == FETCH_IDLE) || (s_fetch_step != step) ||
+      (s_day_lat[i] != lat) || (s_day_lng[i] != lng)) return false;
+  // a fetch from before midnight is for the wrong day
+  return (s_fetch_state == FETCH_PENDING) || (s_days[i].day == step_day(step, lat, lng));
+}
+
+void sky_preview_prefetch(SkyPreviewStep step, float lat, float lng) {
+  if ((step == SKY_PREVIEW_NOW) || fetching(step, lat, lng)) return;
+  sky_preview_cancel();
+  s_fetch_step = step;
+  s_day_lat[1 - s_shown] = lat;
+  s_day_lng[1 - s_shown] = lng;
+  s_fetch_state = FETCH_PENDING;
+  s_fetch_timer = app_timer_register(PREFETCH_DELAY_MS, fetch_step, NULL);
+}
+
+const SkyPreviewDay *sky_preview_show(SkyPreviewStep step, float lat, float lng) {
+  if (!fetching(step, lat, lng)) {
+    s_fetch_step = step;
+    s_fetch_state = FETCH_PENDING;
+  }
+  // a tap that came before the fetch was done finishes it here
+  if (s_fetch_timer) app_timer_cancel(s_fetch_timer);
+  s_fetch_timer = NULL;
+  if (s_fetch_state == FETCH_PENDING) begin_fetch(lat, lng);
+  if (s_fetch_state == FETCH_CALCULATING) calculate_hours(25, lat, lng);
+
+  s_shown = 1 - s_shown;
+  s_fetch_state = FETCH_IDLE;
+  return &s_days[s_shown];
+}
+
+void sky_preview_cancel() {
+  if (s_fetch_timer) app_timer_cancel(s_fetch_timer);
+  s_fetch_timer = NULL;
+  s_fetch_state = FETCH_IDLE;
+}
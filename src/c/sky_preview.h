@@ -0,0 +1,48 @@
+#pragma once
+#include <pebble.h>
+#include "sky_store.h"
+//
+// Previewing the coming days
+//
+// A tap steps the graph through tomorrow, the two days after and the day of
+// the next full moon, in SkyPreviewStep order.  So a tap only has to swap
+// tables in, each step's day is fetched while the step before it is shown:
+// read from the cache if it is there, else calculated a few hours per timer
+// callback like the face's own recompute.  Days follow on from each other,
+// so a day's first sample is the last one of the day before and is taken
+// from it rather than calculated again.  The moon's phase for the day is
+// worked out with the tables.
+//
+// Two days are held: the one shown and the one being fetched.
+//
+
+typedef enum {
+  SKY_PREVIEW_NOW,          // no preview, the face as it is
+  SKY_PREVIEW_TOMORROW,
+  SKY_PREVIEW_DAY_AFTER,
+  SKY_PREVIEW_THIRD_DAY,
+  SKY_PREVIEW_FULL_MOON,
+  SKY_PREVIEW_STEPS
+} SkyPreviewStep;
+
+typedef struct SkyPreviewDay {
+  time_t day;                 // local midnight
+  SkyCacheTracks tracks;
+  int lunar_day;              // moonPhase, at the time of day it was fetched
+  float moon_fraction;        // moonIllumination then
+  float moon_zenith_angle;
+} SkyPreviewDay;
+
+// the step a tap goes to from step: the one after, and back to now after
+// the last
+SkyPreviewStep sky_preview_next(SkyPreviewStep step);
+
+// start fetching step's day, for the location, in the background
+void sky_preview_prefetch(SkyPreviewStep step, float lat, float lng);
+
+// step's day to show, finishing the fetch first if it isn't done (or was
+// for another day or place); it stays put until the next show
+const SkyPreviewDay *sky_preview_show(SkyPreviewStep step, float lat, float lng);
+
+// stop any fetch, for the window going away
+void sky_preview_cancel();
@@ -0,0 +1,128 @@
+#include "sky_profile.h"
+
+#ifdef SKY_PROFILE
+
+typedef struct SkyProfileEntry {
+  uint32_t start;   // when it started, seconds
+  uint32_t heap;    // heap in use when it finished, bytes
+  uint16_t ms;
+  uint8_t kind;     // SkyProfileKind
+} SkyProfileEntry;
+
+static SkyProfileEntry s_ring[SKY_PROFILE_RING];
+static int s_ring_next;       // where the next entry goes
+static int s_ring_count;      // entries since the last dump, up to the ring's size
+static uint32_t s_heap_peak;  // most heap in use when anything was timed, since launch
+static uint16_t s_counters[SKY_PROFILE_COUNTERS];
+
+// the dump being sent: message 0 is the counters, then the entries
+static int s_send_first;      // ring index of the oldest entry
+static int s_send_entries;
+static int s_send_message = -1;   // next message to send, -1 when not sending
+static int s_send_messages;
+
+void sky_profile_record(SkyProfileKind kind, time_t start_s, uint16_t start_ms) {
+  time_t now_s;
+  uint16_t now_ms;
+  time_ms(&now_s, &now_ms);
+  int ms = (int)(now_s - start_s) * 1000 + now_ms - start_ms;
+  uint32_t heap = heap_bytes_used();
+  if (heap > s_heap_peak) s_heap_peak = heap;
+
+  SkyProfileEntry *entry = &s_ring[s_ring_next];
+  entry->start = (uint32_t)start_s;
+  entry->heap = heap;
+  entry->ms = (ms > UINT16_MAX) ? UINT16_MAX : ms;
+  entry->kind = kind;
+  s_ring_next = (s_ring_next + 1) % SKY_PROFILE_RING;
+  if (s_ring_count < SKY_PROFILE_RING) s_ring_count++;
+}
+
+void sky_profile_count(SkyProfileCounter counter) {
+  if (s_counters[counter] < UINT16_MAX) s_counters[counter]++;
+}
+
+// little-endian, as profile.js reads it
+static uint8_t *put_bytes(uint8_t *p, uint32_t value, int bytes) {
+  int i;
+  for (i=0;i<bytes;i++) {
+    *p++ = value & 0xff;
+    value >>= 8;
+  }
+  return p;
+}
+
+static bool send_message() {
+  uint8_t bytes[SKY_PROFILE_ENTRIES_PER_MESSAGE * SKY_PROFILE_ENTRY_BYTES];
+  uint8_t *p = bytes;
+  DictionaryIterator *iter;
+  int i;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) return false;
+  dict_write_int32(iter, MESSAGE_KEY_ProfileIndex, s_send_message);
+  dict_write_int32(iter, MESSAGE_KEY_ProfileCount, s_send_messages);
+  if (s_send_message == 0) {
+    p = put_bytes(p, s_heap_peak, 4);
+    for (i=0;i<SKY_PROFILE_COUNTERS;i++) p = put_bytes(p, s_counters[i], 2);
+    dict_write_data(iter, MESSAGE_KEY_ProfileCounters, bytes, p - bytes);
+  }
+  else {
+    // entries recorded since the dump started go after these in the ring,
+    // so only a burst of more than the ring's size overwrites any
+    int first = (s_send_message - 1) * SKY_PROFILE_ENTRIES_PER_MESSAGE;
+    for (i=first;(i<s_send_entries)&&(i<first+SKY_PROFILE_ENTRIES_PER_MESSAGE);i++) {
+      const SkyProfileEntry *entry = &s_ring[(s_send_first + i) % SKY_PROFILE_RING];
+      p = put_bytes(p, entry->start, 4);
+      p = put_bytes(p, entry->heap, 4);
+      p = put_bytes(p, entry->ms, 2);
+      p = put_bytes(p, entry->kind, 1);
+    }
+    dict_write_data(iter, MESSAGE_KEY_ProfileEntries, bytes, p - bytes);
+  }
+  return app_message_outbox_send() == APP_MSG_OK;
+}
+
+static void send_next() {
+  if ((s_send_message < 0) || (s_send_message >= s_send_messages)) {
+    s_send_message = -1;
+    return;
+  }
+  if (!send_message()) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Profile dump stopped at message %d of %d", s_send_message, s_send_messages);
+    s_send_message = -1;
+  }
+}
+
+// only the dump's own messages move it on
+static bool dump_message(DictionaryIterator *iter) {
+  return (s_send_message >= 0) && (dict_find(iter, MESSAGE_KEY_ProfileIndex) != NULL);
+}
+
+void sky_profile_outbox_sent(DictionaryIterator *iter) {
+  if (!dump_message(iter)) return;
+  s_send_message++;
+  send_next();
+}
+
+void sky_profile_outbox_failed(DictionaryIterator *iter, AppMessageResult reason) {
+  if (!dump_message(iter)) return;
+  APP_LOG(APP_LOG_LEVEL_WARNING, "Profile dump not delivered, reason %d", (int)reason);
+  s_send_message = -1;
+}
+
+void sky_profile_send() {
+  if (s_send_message >= 0) return;
+
+  s_send_entries = s_ring_count;
+  s_send_first = (s_ring_next + SKY_PROFILE_RING - s_ring_count) % SKY_PROFILE_RING;
+  s_send_messages = 1 + (s_send_entries + SKY_PROFILE_ENTRIES_PER_MESSAGE - 1) / SKY_PROFILE_ENTRIES_PER_MESSAGE;
+  s_send_message = 0;
+  send_next();
+  if (s_send_message < 0) return;   // the outbox was busy; kept for next time
+
+  // the counters were copied into the first message, and the entries are
+  // read from the ring as they go; both start again from here
+  s_ring_count = 0;
+  memset(s_counters, 0, sizeof(s_counters));
+}
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+#include <pebble.h>
+//
+// Profiling on the watch
+//
+// Define SKY_PROFILE to time the work the face does: table rebuilds, image
+// loads, frames, inbox messages and event solves are timed with time_ms()
+// into a ring of the last SKY_PROFILE_RING of them, each with the heap in
+// use when it finished.  Redraws and recomputes are counted alongside, and
+// the heap's high-water mark is kept since launch.
+//
+// sky_profile_send() dumps the ring and the counters to PebbleKit JS
+// (src/pkjs/profile.js), which adds them up over the dumps and logs them.
+// The counters start again after each dump.  The face dumps at quarter past
+// and quarter to the hour, out of the way of the hourly recompute.  The
+// outbox callbacks are the face's, which hand them on here; a dump that
+// finds the outbox busy waits for the next quarter.
+//
+// Without SKY_PROFILE the PROFILE_* macros below are empty, so none of it is
+// in release builds.
+//
+
+// #define SKY_PROFILE
+
+#define SKY_PROFILE_RING 64             // timings kept between dumps, a frame a minute and the rest
+#define SKY_PROFILE_ENTRY_BYTES 11      // as sent: start, heap, ms, kind
+#define SKY_PROFILE_ENTRIES_PER_MESSAGE 8
+
+// what was timed; the names in profile.js follow this order
+typedef enum {
+  SKY_PROFILE_TABLES,     // a day's tables calculated, or a recompute step
+  SKY_PROFILE_IMAGES,     // a sun or moon image picked or drawn into its mask
+  SKY_PROFILE_FRAME,      // the canvas drawn
+  SKY_PROFILE_INBOX,      // an AppMessage handled, phone tables included
+  SKY_PROFILE_EVENTS,     // rise and set times solved
+  SKY_PROFILE_PEEK_FRAME, // the canvas drawn while a Quick View peek moves
+  SKY_PROFILE_KINDS
+} SkyProfileKind;
+
+// what is counted; sent in this order too
+typedef enum {
+  SKY_PROFILE_FRAMES,
+  SKY_PROFILE_SKY_REDRAWS,      // frames the sky state asked for
+  SKY_PROFILE_TEXT_UPDATES,
+  SKY_PROFILE_DAYS_CALCULATED,  // day tables worked out on the watch
+  SKY_PROFILE_LOCATION_MOVES,   // recomputes for a new location
+  SKY_PROFILE_COUNTERS
+} SkyProfileCounter;
+
+#ifdef SKY_PROFILE
+
+// keep the time since start_s/start_ms as one of the kinds
+void sky_profile_record(SkyProfileKind kind, time_t start_s, uint16_t start_ms);
+void sky_profile_count(SkyProfileCounter counter);
+// send the ring and the counters to the phone, a message at a time
+void sky_profile_send();
+// outbox callbacks, passed on by the face's own; other messages are ignored
+void sky_profile_outbox_sent(DictionaryIterator *iter);
+void sky_profile_outbox_failed(DictionaryIterator *iter, AppMessageResult reason);
+
+#define PROFILE_START(name) time_t profile_##name##_s; uint16_t profile_##name##_ms; time_ms(&profile_##name##_s, &profile_##name##_ms)
+#define PROFILE_END(name, kind) sky_profile_record(kind, profile_##name##_s, profile_##name##_ms)
+#define PROFILE_COUNT(counter) sky_profile_count(counter)
+#define PROFILE_SEND() sky_profile_send()
+#define PROFILE_OUTBOX_SENT(iter) sky_profile_outbox_sent(iter)
+#define PROFILE_OUTBOX_FAILED(iter, reason) sky_profile_outbox_failed(iter, reason)
+
+#else
+
+#define PROFILE_START(name)
+#define PROFILE_END(name, kind)
+#define PROFILE_COUNT(counter)
+#define PROFILE_SEND()
+#define PROFILE_OUTBOX_SENT(iter)
+#define PROFILE_OUTBOX_FAILED(iter, reason)
+
+#endif
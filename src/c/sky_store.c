@@ -0,0 +1,184 @@
+#include "sky_store.h"
+#include "sky_track.h"
+
+static int16_t *s_block;   // SKY_TRACK_COUNT tracks of s_samples each
+static int s_samples;      // hours + 1
+static int s_head;         // ring position of the sample at s_start
+static time_t s_start;
+static uint32_t s_valid[SKY_HORIZON_HOURS / 32 + 1];  // bit per ring position holding a sample
+
+// ring position of the sample h hours after the start
+#define RING(h) ((s_head + (h)) % s_samples)
+#define SAMPLE(track, h) s_block[(track) * s_samples + RING(h)]
+
+static bool has_sample(int h) {
+  int r = RING(h);
+  return s_valid[r / 32] & (1u << (r % 32));
+}
+
+static void set_sample_valid(int h, bool valid) {
+  int r = RING(h);
+  if (valid) s_valid[r / 32] |= 1u << (r % 32);
+  else s_valid[r / 32] &= ~(1u << (r % 32));
+}
+
+// the float tables and their fitted slopes, for one day
+#define FLOAT_TABLE_BYTES (2 * SKY_TRACK_COUNT * 25 * (int)sizeof(float))
+
+static bool is_azimuth(SkyTrack track) {
+  return (track == SKY_SOLAR_AZI) || (track == SKY_LUNAR_AZI);
+}
+
+// whole hours from the start to a later time, or -1 for an earlier one
+static int hours_from_start(time_t when) {
+  if (when < s_start) return -1;
+  return (int)((when - s_start) / 3600);
+}
+
+bool sky_store_create(int hours, time_t start) {
+  int bytes = SKY_TRACK_COUNT * (hours + 1) * sizeof(int16_t);
+  if (hours > SKY_HORIZON_HOURS) return false;
+  s_block = malloc(bytes);
+  if (!s_block) return false;
+  memset(s_block, 0, bytes);
+  s_samples = hours + 1;
+  s_head = 0;
+  s_start = start;
+  sky_store_clear();
+  APP_LOG(APP_LOG_LEVEL_INFO, "Track store: %d bytes for %d hours, %d bytes per day covered (float tables: %d)",
+          bytes, hours, bytes * 24 / hours, FLOAT_TABLE_BYTES);
+  return true;
+}
+
+void sky_store_destroy() {
+  free(s_block);
+  s_block = NULL;
+}
+
+int sky_store_hours() {
+  return s_block ? s_samples - 1 : 0;
+}
+
+time_t sky_store_start() {
+  return s_start;
+}
+
+void sky_store_advance(time_t start) {
+  int shift = hours_from_start(start);
+  int h;
+  if ((shift > 0) && (shift < s_samples)) {
+    // the ring turns: the hours before the new start are dropped, and their
+    // places come round again at the end of the horizon
+    for (h=0;h<shift;h++) set_sample_valid(h, false);
+    s_head = RING(shift);
+  }
+  else {
+    sky_store_clear();
+  }
+  s_start = start;
+}
+
+void sky_store_clear() {
+  memset(s_valid, 0, sizeof(s_valid));
+}
+
+bool sky_store_contains(time_t day) {
+  int offset = hours_from_start(day);
+  int i;
+  if (!s_block || (offset < 0) || (offset + 24 >= s_samples)) return false;
+  for (i=0;i<=24;i++) {
+    if (!has_sample(offset + i)) return false;
+  }
+  return true;
+}
+
+static void put_sample(SkyTrack track, int h, int32_t centidegrees) {
+  if (is_azimuth(track) && (centidegrees >= 18000)) centidegrees -= 36000;
+  SAMPLE(track, h) = centidegrees;
+}
+
+void sky_store_put_tracks(time_t day, const SkyCacheTracks *tracks) {
+  int offset = hours_from_start(day);
+  int i;
+  if (!s_block || (offset < 0) || (offset >= s_samples)) return;
+
+  for (i=0;(i<25)&&(offset+i<s_samples);i++) {
+    put_sample(SKY_SOLAR_ELEV, offset + i, tracks->solar_elev[i]);
+    put_sample(SKY_SOLAR_AZI, offset + i, tracks->solar_azi[i]);
+    put_sample(SKY_LUNAR_ELEV, offset + i, tracks->lunar_elev[i]);
+    put_sample(SKY_LUNAR_AZI, offset + i, tracks->lunar_azi[i]);
+    set_sample_valid(offset + i, true);
+  }
+}
+
+void sky_store_put_day(time_t day, const float solar_elev[], const float solar_azi[], const float lunar_elev[], const float lunar_azi[]) {
+  // kept off the stack, which is small on the watch
+  static SkyCacheTracks s_tracks;
+  sky_cache_pack(&s_tracks, solar_elev, solar_azi, lunar_elev, lunar_azi);
+  sky_store_put_tracks(day, &s_tracks);
+}
+
+// difference b - a, the short way round for azimuths
+static int32_t sample_delta(int32_t a, int32_t b, bool wrap360) {
+  int32_t d = b - a;
+  if (wrap360) {
+    if (d > 18000) d -= 36000;
+    if (d < -18000) d += 36000;
+  }
+  return d;
+}
+
+// the segment from value0 to value1 at s of the way along, with the samples
+// either side where they are there; twice the slopes, centred differences
+// inside (Catmull-Rom) and one-sided at the ends, as sky_track_fit() in
+// host/ fits them
+static float eval_segment(int32_t before, bool has_before, int32_t value0, int32_t value1,
+                          int32_t after, bool has_after, float s, bool wrap360) {
+  int32_t delta = sample_delta(value0, value1, wrap360);
+  int32_t slope0 = has_before ? sample_delta(before, value1, wrap360) : 2 * delta;
+  int32_t slope1 = has_after ? sample_delta(value0, after, wrap360) : 2 * delta;
+
+  // azimuths come back folded into 0..360
+  return sky_track_segment(value0 / 100.0f, delta / 100.0f, slope0 / 200.0f, slope1 / 200.0f, s, wrap360);
+}
+
+float sky_store_eval(SkyTrack track, float hour) {
+  int last = s_samples - 1;
+  int i = (int)hour;
+  if (!s_block) return 0;
+  if (i < 0) i = 0;
+  if (i > last-1) i = last-1;
+
+  // an hour that isn't in yet, next to one that is or not
+  if (!has_sample(i) || !has_sample(i+1)) {
+    int h = has_sample(i) ? i : i+1;
+    if (!has_sample(h)) return 0;
+    float value = SAMPLE(track, h) / 100.0f;
+    return (is_azimuth(track) && (value < 0)) ? value + 360 : value;
+  }
+
+  // a neighbouring day that isn't in yet counts as an end
+  bool has_before = (i > 0) && has_sample(i-1);
+  bool has_after = (i+1 < last) && has_sample(i+2);
+  return eval_segment(has_before ? SAMPLE(track, i-1) : 0, has_before, SAMPLE(track, i), SAMPLE(track, i+1),
+                      has_after ? SAMPLE(track, i+2) : 0, has_after, hour - i, is_azimuth(track));
+}
+
+// a sample of a day's tracks as the cache holds them
+static int32_t tracks_sample(const SkyCacheTracks *tracks, SkyTrack track, int h) {
+  switch (track) {
+    case SKY_SOLAR_ELEV: return tracks->solar_elev[h];
+    case SKY_SOLAR_AZI: return tracks->solar_azi[h];
+    case SKY_LUNAR_ELEV: return tracks->lunar_elev[h];
+    default: return tracks->lunar_azi[h];
+  }
+}
+
+float sky_tracks_eval(const SkyCacheTracks *tracks, SkyTrack track, float hour) {
+  int i = (int)hour;
+  if (i < 0) i = 0;
+  if (i > 23) i = 23;
+  return eval_segment((i > 0) ? tracks_sample(tracks, track, i-1) : 0, i > 0,
+                      tracks_sample(tracks, track, i), tracks_sample(tracks, track, i+1),
+                      (i < 23) ? tracks_sample(tracks, track, i+2) : 0, i < 23, hour - i, is_azimuth(track));
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <pebble.h>
+#include "sky_cache.h"
+//
+// Packed store of the face's sun and moon tracks
+//
+// The tracks for the SKY_HORIZON_HOURS from today's local midnight are kept
+// as hourly samples in hundredths of a degree: four int16 tracks side by
+// side in one allocated block, 2 bytes a sample where the float tables and
+// their fitted slopes took 8.  Azimuths are held as -18000..17999 to fit.
+//
+// The block is a ring.  When the day rolls over, the start moves on a day
+// and the days still in the horizon stay where they are, so only the day
+// coming into the horizon has to be read from the cache or calculated.
+//
+// Tracks evaluate as the same Hermite splines as sky_track.h, with each
+// slope worked out from the neighbouring samples when it is needed.
+//
+
+typedef enum {
+  SKY_SOLAR_ELEV,
+  SKY_SOLAR_AZI,
+  SKY_LUNAR_ELEV,
+  SKY_LUNAR_AZI,
+  SKY_TRACK_COUNT
+} SkyTrack;
+
+// allocate the store for hours from the local midnight start; false if
+// there isn't the memory, and the store stays empty
+bool sky_store_create(int hours, time_t start);
+void sky_store_destroy();
+
+int sky_store_hours();
+
+// local midnight of the first sample
+time_t sky_store_start();
+
+// move the start on to a later local midnight, keeping the days still in
+// the horizon; anything else empties the store
+void sky_store_advance(time_t start);
+
+// forget every day, for a change of location
+void sky_store_clear();
+
+// true once the day (a local midnight) has been put in whole
+bool sky_store_contains(time_t day);
+
+// put in a day's 25 samples; any outside the horizon are dropped
+void sky_store_put_tracks(time_t day, const SkyCacheTracks *tracks);
+void sky_store_put_day(time_t day, const float solar_elev[], const float solar_azi[], const float lunar_elev[], const float lunar_azi[]);
+
+// the track in degrees at hour (fractional, 0..hours from the start); an
+// hour the store has no samples for gives the nearer sample it does have,
+// or 0, so check sky_store_contains() first
+float sky_store_eval(SkyTrack track, float hour);
+
+// the same for one day's tracks as the cache holds them, hour 0..24
+float sky_tracks_eval(const SkyCacheTracks *tracks, SkyTrack track, float hour);
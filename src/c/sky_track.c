@@ -0,0 +1,15 @@
+#include <pebble.h>
+#include "sky_track.h"
+
+float sky_track_segment(float value, float delta, float slope0, float slope1, float s, bool wrap360) {
+  // Hermite basis on a unit interval, in Horner form
+  float c2 = 3 * delta - 2 * slope0 - slope1;
+  float c3 = slope0 + slope1 - 2 * delta;
+  float result = value + s * (slope0 + s * (c2 + s * c3));
+
+  if (wrap360) {
+    if (result >= 360) result -= 360;
+    if (result < 0) result += 360;
+  }
+  return result;
+}
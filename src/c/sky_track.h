@@ -0,0 +1,17 @@
+#pragma once
+#include <pebble.h>
+//
+// Daily sun and moon trajectories as cubic Hermite splines through the
+// hourly table samples.  The slopes at a segment's ends come from the
+// samples either side (sky_store.c); any time of day can then be evaluated
+// with a handful of multiply-adds, without calling sunPosition/moonPosition
+// again.  Fitting and evaluating whole tables, for the accuracy sweep, is in
+// host/sky_track_fit.c.
+//
+// Azimuth tracks wrap at 360 degrees, so their differences are taken the
+// short way round and the result is folded back into 0..360.
+//
+
+// one segment of a track, from value to value + delta with slopes slope0 and
+// slope1 at its ends, at s (0..1) of the way along
+float sky_track_segment(float value, float delta, float slope0, float slope1, float s, bool wrap360);
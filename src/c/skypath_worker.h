@@ -0,0 +1,20 @@
+#pragma once
+//
+// Messages between the watchface and the background worker
+//
+// The worker precomputes the coming days' sky paths into the persistent
+// cache (sky_cache.h) and tells the face about each day it adds.  The face
+// tells the worker when the location changes.
+//
+// The worker only runs with the BackgroundWorker setting on: launching it
+// asks the user to replace any other app's worker.  With it off the face
+// precomputes the coming days itself, a few hours at a time.
+//
+
+// worker -> face: a day was added to the cache, data0 is its day number
+#define WORKER_MSG_TABLES_READY 1
+// face -> worker: the location setting changed, re-read it
+#define WORKER_MSG_LOCATION_CHANGED 2
+
+// compact day number of a local midnight, fits an AppWorkerMessage field
+#define SKY_DAY_NUMBER(midnight) ((uint16_t)(((midnight) + 43200) / 86400))
@@ -14,14 +14,21 @@ module.exports = [
         "type": "heading",
         "defaultValue": "Location"
       },
+      {
+        "type": "toggle",
+        "messageKey": "AutoLocation",
+        "label": "Use the phone's location",
+        "description": "Follows the phone's GPS, and ignores the sliders below.",
+        "defaultValue": false
+      },
       {
         "type": "slider",
         "messageKey": "Latitude",
-        "defaultValue": "65",
+        "defaultValue": "64.8",
         "label": "Latitude, + for North",
         "min": -90,
         "max": 90, 
-        "step": 1
+        "step": 0.1
       },
       {
         "type": "slider",
@@ -30,7 +37,7 @@ module.exports = [
         "label": "Longitude, + for East",
         "min": -180,
         "max": 180,
-        "step": 1
+        "step": 0.1
       }
     ]
   },
@@ -47,6 +54,20 @@ module.exports = [
         "label": "Show extra information",
         "defaultValue": true
       },
+      {
+        "type": "toggle",
+        "messageKey": "PhoneEphemeris",
+        "label": "Calculate sky paths on the phone",
+        "description": "More precise, and saves the watch's battery.  The watch still calculates them itself when the phone is away.",
+        "defaultValue": false
+      },
+      {
+        "type": "toggle",
+        "messageKey": "BackgroundWorker",
+        "label": "Calculate sky paths in the background",
+        "description": "Has the coming days ready even when the watchface isn't shown.  Replaces any other app's background worker.",
+        "defaultValue": false
+      },
     ]
   },
   {
@@ -2,5 +2,55 @@
 var Clay = require('pebble-clay');
 // Load our Clay configuration file
 var clayConfig = require('./config');
-// Initialize Clay
-var clay = new Clay(clayConfig);
+// Initialize Clay; the settings are sent from here, see webviewclosed below
+var clay = new Clay(clayConfig, null, { autoHandleEvents: false });
+var messageKeys = require('message_keys');
+
+// Sky path tables worked out on the phone, see sky_tables.js
+var skyTables = require('./sky_tables');
+// the phone's GPS, see location.js
+var gps = require('./location');
+// timings from watches built with SKY_PROFILE, see profile.js
+var profile = require('./profile');
+
+Pebble.addEventListener('ready', function() {
+  // let the watch know it can ask for tables now
+  Pebble.sendAppMessage({ SkyPhoneReady: 1 });
+  gps.start();
+});
+
+Pebble.addEventListener('showConfiguration', function() {
+  Pebble.openURL(clay.generateUrl());
+});
+
+Pebble.addEventListener('webviewclosed', function(e) {
+  if (!e || !e.response) return;
+  var dict = clay.getSettings(e.response);
+
+  // the location goes to the watch in hundredths of a degree, and only
+  // from the sliders when it isn't following the GPS; Clay has already
+  // made the sliders' 0.1 degree steps into whole tenths
+  if (dict[messageKeys.AutoLocation]) {
+    delete dict[messageKeys.Latitude];
+    delete dict[messageKeys.Longitude];
+  }
+  else {
+    dict[messageKeys.Latitude] = gps.tenthsToCentidegrees(dict[messageKeys.Latitude]);
+    dict[messageKeys.Longitude] = gps.tenthsToCentidegrees(dict[messageKeys.Longitude]);
+  }
+  Pebble.sendAppMessage(dict, function() {
+    gps.start();
+  }, function() {
+    console.log('Settings not delivered to the watch');
+  });
+});
+
+Pebble.addEventListener('appmessage', function(e) {
+  var msg = e.payload;
+  if (msg.SkyRequest !== undefined) {
+    skyTables.send(msg.SkyRequest, msg.SkyDays, msg.SkyLatitude, msg.SkyLongitude);
+  }
+  if (msg.ProfileIndex !== undefined) {
+    profile.receive(msg);
+  }
+});
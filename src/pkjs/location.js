@@ -0,0 +1,62 @@
+//
+// Location for the watch
+//
+// The watch takes its latitude and longitude in hundredths of a degree,
+// from the settings page or, with "use the phone's location" on, from the
+// phone's GPS: once when the watchface starts and then every
+// UPDATE_INTERVAL_MS while it runs.  Fixes are sent with LocationFix, and
+// the watch ignores those too small to change its rise and set times, so
+// they can be sent as they come.
+//
+
+var UPDATE_INTERVAL_MS = 30 * 60 * 1000;
+var GPS_OPTIONS = { enableHighAccuracy: false, timeout: 30000, maximumAge: 10 * 60 * 1000 };
+
+var timer = null;
+
+function centidegrees(degrees) {
+  return Math.round(parseFloat(degrees) * 100);
+}
+
+// a slider's value as Clay sends it, in tenths of a degree
+function tenthsToCentidegrees(tenths) {
+  return Math.round(parseFloat(tenths) * 10);
+}
+
+// the saved settings, as Clay keeps them
+function autoLocation() {
+  try {
+    var settings = JSON.parse(localStorage.getItem('clay-settings')) || {};
+    return !!settings.AutoLocation;
+  } catch (err) {
+    return false;
+  }
+}
+
+function sendFix() {
+  navigator.geolocation.getCurrentPosition(function(pos) {
+    // marked as a fix, so the watch can ignore it wandering about
+    Pebble.sendAppMessage({
+      Latitude: centidegrees(pos.coords.latitude),
+      Longitude: centidegrees(pos.coords.longitude),
+      LocationFix: 1
+    }, null, function() {
+      console.log('Location not delivered to the watch');
+    });
+  }, function(err) {
+    console.log('No location fix: ' + err.message);
+  }, GPS_OPTIONS);
+}
+
+// follow the GPS if the settings say to, or stop following it
+function start() {
+  if (timer) clearInterval(timer);
+  timer = null;
+  if (!autoLocation()) return;
+  sendFix();
+  timer = setInterval(sendFix, UPDATE_INTERVAL_MS);
+}
+
+module.exports.start = start;
+module.exports.centidegrees = centidegrees;
+module.exports.tenthsToCentidegrees = tenthsToCentidegrees;
@@ -0,0 +1,97 @@
+//
+// Timings from the watch
+//
+// A watch built with SKY_PROFILE (src/c/sky_profile.h) sends what it has
+// timed twice an hour: a first message of counters, then the entries of its
+// timing ring, 11 bytes each.  They are added up here over every dump since
+// the phone app started and the totals are logged as each dump completes.
+//
+
+var KINDS = ['tables', 'images', 'frame', 'inbox', 'events', 'peek frame'];   // SkyProfileKind
+var COUNTERS = ['frames', 'sky redraws', 'text updates', 'days calculated', 'location moves'];   // SkyProfileCounter
+var ENTRY_BYTES = 11;
+
+var totals = { dumps: 0, heapPeak: 0, kinds: {}, counters: {} };
+var dump = null;   // the dump coming in
+
+function readBytes(bytes, pos, count) {
+  var value = 0;
+  var i;
+  for (i = count - 1; i >= 0; i--) value = value * 256 + bytes[pos + i];
+  return value;
+}
+
+function addCounters(bytes) {
+  var i;
+  dump.heapPeak = readBytes(bytes, 0, 4);
+  for (i = 0; i < COUNTERS.length && 4 + 2 * i + 2 <= bytes.length; i++) {
+    dump.counters[COUNTERS[i]] = readBytes(bytes, 4 + 2 * i, 2);
+  }
+}
+
+function addEntries(bytes) {
+  var pos, kind, ms, heap;
+  for (pos = 0; pos + ENTRY_BYTES <= bytes.length; pos += ENTRY_BYTES) {
+    heap = readBytes(bytes, pos + 4, 4);
+    ms = readBytes(bytes, pos + 8, 2);
+    kind = KINDS[bytes[pos + 10]] || ('kind ' + bytes[pos + 10]);
+    if (!dump.kinds[kind]) dump.kinds[kind] = { count: 0, ms: 0, maxMs: 0, maxHeap: 0 };
+    var k = dump.kinds[kind];
+    k.count++;
+    k.ms += ms;
+    if (ms > k.maxMs) k.maxMs = ms;
+    if (heap > k.maxHeap) k.maxHeap = heap;
+  }
+}
+
+function addDump() {
+  var name, k, t;
+  totals.dumps++;
+  if (dump.heapPeak > totals.heapPeak) totals.heapPeak = dump.heapPeak;
+  for (name in dump.counters) {
+    totals.counters[name] = (totals.counters[name] || 0) + dump.counters[name];
+  }
+  for (name in dump.kinds) {
+    k = dump.kinds[name];
+    t = totals.kinds[name] || { count: 0, ms: 0, maxMs: 0, maxHeap: 0 };
+    t.count += k.count;
+    t.ms += k.ms;
+    t.maxMs = Math.max(t.maxMs, k.maxMs);
+    t.maxHeap = Math.max(t.maxHeap, k.maxHeap);
+    totals.kinds[name] = t;
+  }
+}
+
+function log() {
+  var name, t, counts = [];
+  console.log('Watch profile, ' + totals.dumps + ' dumps, heap peak ' + totals.heapPeak + ' bytes');
+  for (name in totals.kinds) {
+    t = totals.kinds[name];
+    console.log('  ' + name + ': ' + t.count + ' timed, ' + Math.round(t.ms / t.count) + ' ms average, ' +
+                t.maxMs + ' ms at most, heap up to ' + t.maxHeap + ' bytes');
+  }
+  for (name in totals.counters) counts.push(totals.counters[name] + ' ' + name);
+  console.log('  counted: ' + counts.join(', '));
+}
+
+// a message of a dump; a dump that arrives with a gap in it is dropped
+function receive(msg) {
+  var index = msg.ProfileIndex;
+  if (index === 0) {
+    dump = { next: 0, heapPeak: 0, kinds: {}, counters: {} };
+  }
+  if (!dump || index !== dump.next) {
+    dump = null;
+    return;
+  }
+  if (msg.ProfileCounters) addCounters(msg.ProfileCounters);
+  if (msg.ProfileEntries) addEntries(msg.ProfileEntries);
+  dump.next++;
+  if (dump.next >= msg.ProfileCount) {
+    addDump();
+    dump = null;
+    log();
+  }
+}
+
+module.exports.receive = receive;
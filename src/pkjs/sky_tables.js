@@ -0,0 +1,197 @@
+//
+// Sky path tables computed on the phone
+//
+// The watch asks for the coming days' tables when the "phone ephemeris"
+// setting is on.  They are computed here with the suncalc formulas in double
+// precision (and a real arcsine, where the watch uses the small angle one),
+// then packed to fit the watch's 128 byte inbox:
+//
+//   - each day is four tracks of 25 hourly samples, in hundredths of a degree,
+//     in the order solar elevation, solar azimuth, lunar elevation, lunar azimuth
+//   - each track is its first sample, then the first hour's change, then the
+//     change in that change from hour to hour (azimuth changes wrapped into
+//     -180..180 degrees); the tracks are smooth, so these stay small
+//   - every value is zigzag encoded and written as a little-endian base 128
+//     varint, so most differences take one or two bytes
+//   - the bytes are sent CHUNK_BYTES at a time, tagged with the day, the
+//     location and the chunk's place, one AppMessage after another
+//
+// The decoding side is src/c/sky_phone.c.
+//
+
+// suncalc.js, (c) 2011-2015, Vladimir Agafonkin, https://github.com/mourner/suncalc
+
+var rad = Math.PI / 180;
+var e = rad * 23.4397; // obliquity of the Earth
+
+function toDays(unixdate) {
+  return (unixdate - 946684800) / 86400 - 0.5;
+}
+
+function rightAscension(l, b) {
+  return Math.atan2(Math.sin(l) * Math.cos(e) - Math.tan(b) * Math.sin(e), Math.cos(l));
+}
+
+function declination(l, b) {
+  return Math.asin(Math.sin(b) * Math.cos(e) + Math.cos(b) * Math.sin(e) * Math.sin(l));
+}
+
+function azimuth(H, phi, dec) {
+  return Math.atan2(Math.sin(H), Math.cos(H) * Math.sin(phi) - Math.tan(dec) * Math.cos(phi));
+}
+
+function altitude(H, phi, dec) {
+  return Math.asin(Math.sin(phi) * Math.sin(dec) + Math.cos(phi) * Math.cos(dec) * Math.cos(H));
+}
+
+function siderealTime(d, lw) {
+  return rad * (280.16 + 360.9856235 * d) - lw;
+}
+
+function sunPosition(unixdate, lat, lng) {
+  var d = toDays(unixdate);
+  var M = rad * (357.5291 + 0.98560028 * d);
+  var C = rad * (1.9148 * Math.sin(M) + 0.02 * Math.sin(2 * M) + 0.0003 * Math.sin(3 * M));
+  var L = M + C + rad * 102.9372 + Math.PI;
+  var H = siderealTime(d, rad * -lng) - rightAscension(L, 0);
+  var dec = declination(L, 0);
+  return { azimuth: azimuth(H, rad * lat, dec), altitude: altitude(H, rad * lat, dec) };
+}
+
+function moonPosition(unixdate, lat, lng) {
+  var d = toDays(unixdate);
+  var L = rad * (218.316 + 13.176396 * d); // ecliptic longitude
+  var M = rad * (134.963 + 13.064993 * d); // mean anomaly
+  var F = rad * (93.272 + 13.229350 * d);  // mean distance
+  var l = L + rad * 6.289 * Math.sin(M);   // longitude
+  var b = rad * 5.128 * Math.sin(F);       // latitude
+  var H = siderealTime(d, rad * -lng) - rightAscension(l, b);
+  var dec = declination(l, b);
+  return { azimuth: azimuth(H, rad * lat, dec), altitude: altitude(H, rad * lat, dec) };
+}
+
+// packing
+
+var CHUNK_BYTES = 64;      // matches SKY_PHONE_CHUNK_BYTES on the watch
+var SEND_RETRIES = 3;      // attempts per message after the first
+var RETRY_DELAY_MS = 1000;
+
+function centidegrees(radians) {
+  return Math.round(radians / rad * 100);
+}
+
+// azimuth from north, 0..36000, as the watch tables have it
+function azimuthCentidegrees(radians) {
+  return (centidegrees(radians + Math.PI) % 36000 + 36000) % 36000;
+}
+
+function pushVarint(bytes, value) {
+  var zigzag = value < 0 ? -2 * value - 1 : 2 * value;
+  while (zigzag >= 0x80) {
+    bytes.push((zigzag & 0x7f) | 0x80);
+    zigzag = Math.floor(zigzag / 128);
+  }
+  bytes.push(zigzag);
+}
+
+function pushTrack(bytes, samples, wrap) {
+  var i, delta, lastDelta = 0;
+  pushVarint(bytes, samples[0]);
+  for (i = 1; i < samples.length; i++) {
+    delta = samples[i] - samples[i - 1];
+    if (wrap) {
+      if (delta >= 18000) delta -= 36000;
+      if (delta < -18000) delta += 36000;
+    }
+    pushVarint(bytes, delta - lastDelta);
+    lastDelta = delta;
+  }
+}
+
+// the packed tables for the 25 hours from a local midnight
+function packDay(dayStart, lat, lng) {
+  var solarElev = [], solarAzi = [], lunarElev = [], lunarAzi = [];
+  var i, t, sun, moon;
+  for (i = 0; i <= 24; i++) {
+    t = dayStart + i * 3600;
+    sun = sunPosition(t, lat, lng);
+    moon = moonPosition(t, lat, lng);
+    solarElev.push(centidegrees(sun.altitude));
+    solarAzi.push(azimuthCentidegrees(sun.azimuth));
+    lunarElev.push(centidegrees(moon.altitude));
+    lunarAzi.push(azimuthCentidegrees(moon.azimuth));
+  }
+  var bytes = [];
+  pushTrack(bytes, solarElev, false);
+  pushTrack(bytes, solarAzi, true);
+  pushTrack(bytes, lunarElev, false);
+  pushTrack(bytes, lunarAzi, true);
+  return bytes;
+}
+
+// sending, one message at a time, each retried until the watch acks it
+
+var queue = [];
+var generation = 0;  // bumped by each request, so stale callbacks are ignored
+var stats = null;
+
+function sendNext(attempt, gen) {
+  if (gen !== generation) return;
+  if (queue.length === 0) {
+    console.log('Sky tables sent: ' + stats.bytes + ' bytes in ' + stats.messages + ' messages, ' +
+                stats.retries + ' retries, ' + (Date.now() - stats.start) + ' ms');
+    return;
+  }
+  Pebble.sendAppMessage(queue[0], function() {
+    if (gen !== generation) return;
+    stats.bytes += queue[0].SkyChunk.length;
+    stats.messages++;
+    queue.shift();
+    sendNext(0, gen);
+  }, function() {
+    if (gen !== generation) return;
+    if (attempt < SEND_RETRIES) {
+      stats.retries++;
+      setTimeout(function() { sendNext(attempt + 1, gen); }, RETRY_DELAY_MS);
+    }
+    else {
+      // give up; the watch calculates whatever it is missing itself
+      console.log('Sky tables not acknowledged, dropping ' + queue.length + ' messages');
+      queue = [];
+    }
+  });
+}
+
+// answer a request from the watch: days from its local midnight today, at
+// its location in hundredths of a degree
+function send(today, days, latCenti, lngCenti) {
+  var lat = latCenti / 100;
+  var lng = lngCenti / 100;
+  var date = new Date(today * 1000);
+  var d, c, bytes, count;
+
+  // a newer request replaces whatever is still waiting to go
+  generation++;
+  queue = [];
+  stats = { bytes: 0, messages: 0, retries: 0, start: Date.now() };
+  for (d = 0; d < days; d++) {
+    bytes = packDay(date.getTime() / 1000, lat, lng);
+    count = Math.ceil(bytes.length / CHUNK_BYTES);
+    for (c = 0; c < count; c++) {
+      queue.push({
+        SkyDay: date.getTime() / 1000,
+        SkyLatitude: latCenti,
+        SkyLongitude: lngCenti,
+        SkyChunkIndex: c,
+        SkyChunkCount: count,
+        SkyChunk: bytes.slice(c * CHUNK_BYTES, (c + 1) * CHUNK_BYTES)
+      });
+    }
+    // next local midnight, whatever daylight saving does in between
+    date.setDate(date.getDate() + 1);
+  }
+  sendNext(0, generation);
+}
+
+module.exports.send = send;
+module.exports.packDay = packDay;
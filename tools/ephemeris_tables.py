@@ -0,0 +1,93 @@
+#!/usr/bin/env python
+#
+# Generate the ephemeris kernels' lookup tables
+#
+#   ephemeris_tables.py src/c/ephemeris_tables.h ephemeris_tables.c
+#
+# The sizes and scales are read from the header, so it stays the one place
+# they are set; see it for what each table holds.  Runs under python 2 (the
+# Pebble SDK's waf) and python 3 (host/Makefile).
+#
+
+import math
+import re
+import sys
+
+
+def read_sizes(header_path):
+    sizes = {}
+    with open(header_path) as header:
+        for line in header:
+            match = re.match(r'#define (\w+) (\d+)', line)
+            if match:
+                sizes[match.group(1)] = int(match.group(2))
+    return sizes
+
+
+def angle_units(radians, quarter_turn):
+    return int(round(radians / (math.pi / 2) * quarter_turn))
+
+
+def asin_tables(sizes):
+    quarter = sizes['TABLE_QUARTER_TURN']
+    steps = sizes['ASIN_TABLE_STEPS']
+    tail_steps = sizes['ASIN_TAIL_STEPS']
+    tail_start = 1.0 - 1.0 / sizes['ASIN_TAIL_FRACTION']
+    table = [angle_units(math.asin(float(i) / steps), quarter) for i in range(steps + 1)]
+    tail = [angle_units(math.asin(tail_start + (1 - tail_start) * i / tail_steps), quarter)
+            for i in range(tail_steps + 1)]
+    return table, tail
+
+
+def atan_table(sizes):
+    quarter = sizes['TABLE_QUARTER_TURN']
+    steps = sizes['ATAN_TABLE_STEPS']
+    return [angle_units(math.atan(float(i) / steps), quarter) for i in range(steps + 1)]
+
+
+def centre_table(sizes):
+    # suncalc's equation of centre, in degrees, over a turn of the sun's
+    # mean anomaly; the last entry wraps round to the first
+    steps = sizes['CENTRE_TABLE_STEPS']
+    scale = sizes['CENTRE_TABLE_SCALE']
+    entries = []
+    for i in range(steps + 1):
+        m = 2 * math.pi * i / steps
+        c = 1.9148 * math.sin(m) + 0.02 * math.sin(2 * m) + 0.0003 * math.sin(3 * m)
+        entries.append(int(round(c * scale)))
+    return entries
+
+
+def c_array(c_type, name, size, values):
+    lines = ['const {} {}[{}] = {{'.format(c_type, name, size)]
+    for i in range(0, len(values), 12):
+        lines.append('  ' + ', '.join(str(v) for v in values[i:i + 12]) + ',')
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def generate(header_path):
+    sizes = read_sizes(header_path)
+    asin, asin_tail = asin_tables(sizes)
+    parts = [
+        '// Generated by tools/ephemeris_tables.py from ephemeris_tables.h; do not edit',
+        '#include <stdint.h>',
+        '',
+        c_array('uint16_t', 'ephemeris_asin_table', str(sizes['ASIN_TABLE_STEPS'] + 1), asin),
+        '',
+        c_array('uint16_t', 'ephemeris_asin_tail_table', str(sizes['ASIN_TAIL_STEPS'] + 1), asin_tail),
+        '',
+        c_array('uint16_t', 'ephemeris_atan_table', str(sizes['ATAN_TABLE_STEPS'] + 1), atan_table(sizes)),
+        '',
+        c_array('int16_t', 'ephemeris_centre_table', str(sizes['CENTRE_TABLE_STEPS'] + 1), centre_table(sizes)),
+        '',
+    ]
+    return '\n'.join(parts)
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 3:
+        sys.exit('usage: ephemeris_tables.py ephemeris_tables.h ephemeris_tables.c')
+    source = generate(sys.argv[1])
+    with open(sys.argv[2], 'w') as out:
+        out.write(source)
@@ -0,0 +1,3 @@
+// The worker builds the watchface's ephemeris.c as part of its own image
+#define SKYPATH_WORKER
+#include "../../src/c/ephemeris.c"
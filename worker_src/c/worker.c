@@ -0,0 +1,81 @@
+#define SKYPATH_WORKER
+#include <pebble_worker.h>
+#include "../../src/c/ephemeris.h"
+#include "../../src/c/sky_cache.h"
+#include "../../src/c/settings.h"
+#include "../../src/c/skypath_worker.h"
+//
+// Background worker for the ephemeris watchface
+//
+// The worker owns the sky path computation.  When it starts, every hour, and
+// whenever the face reports a new location, it fills the persistent cache
+// with today and the coming days and tells the face about each day it adds.
+// The face then only reads the cache and renders; if the worker isn't
+// running the face falls back to computing the tables itself.
+//
+
+static ClaySettings s_settings;
+// kept off the worker's small stack
+static float s_solar_elev[25];
+static float s_solar_azi[25];
+static float s_lunar_elev[25];
+static float s_lunar_azi[25];
+
+static void prv_load_settings() {
+  // same defaults as the face, which only saves settings once they change
+  s_settings.Latitude = DEFAULT_LATITUDE;
+  s_settings.Longitude = DEFAULT_LONGITUDE;
+  s_settings.ShowInfo = true;
+  persist_read_data(SETTINGS_KEY, &s_settings, sizeof(s_settings));
+}
+
+static void prv_precompute() {
+  time_t today = local_midnight(time(NULL));
+  int i;
+
+  sky_cache_evict(today);
+  for (i=0;i<SKY_CACHE_DAYS;i++) {
+    // midday of the day i days ahead, so daylight saving changes don't matter
+    time_t day = local_midnight(today + i * 86400 + 12 * 3600);
+    if (sky_cache_contains(day, s_settings.Latitude, s_settings.Longitude)) continue;
+
+    sky_paths_hours(day, 0, 24, s_settings.Latitude, s_settings.Longitude, s_solar_elev, s_solar_azi, s_lunar_elev, s_lunar_azi);
+    sky_cache_store(day, s_settings.Latitude, s_settings.Longitude, s_solar_elev, s_solar_azi, s_lunar_elev, s_lunar_azi);
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "Worker calculated sky paths %d days ahead", i);
+
+    // let the face know, in case it is waiting for this day
+    AppWorkerMessage message = {
+      .data0 = SKY_DAY_NUMBER(day)
+    };
+    app_worker_send_message(WORKER_MSG_TABLES_READY, &message);
+  }
+}
+
+static void prv_tick_handler(struct tm *tick_time, TimeUnits units_changed) {
+  prv_precompute();
+}
+
+static void prv_message_handler(uint16_t type, AppWorkerMessage *message) {
+  if (type == WORKER_MSG_LOCATION_CHANGED) {
+    prv_load_settings();
+    prv_precompute();
+  }
+}
+
+static void prv_init() {
+  prv_load_settings();
+  app_worker_message_subscribe(prv_message_handler);
+  tick_timer_service_subscribe(HOUR_UNIT, prv_tick_handler);
+  prv_precompute();
+}
+
+static void prv_deinit() {
+  tick_timer_service_unsubscribe();
+  app_worker_message_unsubscribe();
+}
+
+int main(void) {
+  prv_init();
+  worker_event_loop();
+  prv_deinit();
+}